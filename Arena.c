@@ -0,0 +1,78 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Arena.h"
+
+#define ARENA_ALIGNMENT 64
+
+size_t arenaSize(size_t size) { return (size + ARENA_ALIGNMENT - 1) & ~((size_t)ARENA_ALIGNMENT - 1); }
+
+char createArena(struct Arena* pArena, size_t size) {
+  pArena->Size = arenaSize(size);
+  pArena->Used = 0;
+  pArena->pBase = NULL;
+
+  if (pArena->Size == 0) {
+    return 0;
+  }
+
+  void* pMemory = mmap(NULL, pArena->Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (pMemory == MAP_FAILED) {
+    perror("mmap");
+    return -1;
+  }
+  pArena->pBase = pMemory;
+
+  // Touch every page in case MAP_POPULATE was not honoured
+  long pageSize = sysconf(_SC_PAGESIZE);
+  for (size_t offset = 0; offset < pArena->Size; offset += pageSize) {
+    ((volatile char*)pArena->pBase)[offset] = 0;
+  }
+
+  // Keep the pages in memory if we are allowed to
+  mlock(pArena->pBase, pArena->Size);
+
+  return 0;
+}
+
+void* arenaAlloc(struct Arena* pArena, size_t size) {
+  size_t alignedSize = arenaSize(size);
+
+  if (pArena->Size - pArena->Used < alignedSize) {
+    fprintf(stderr, "Fail to allocate %zu bytes from the arena\n", size);
+    return NULL;
+  }
+
+  void* pMemory = pArena->pBase + pArena->Used;
+  pArena->Used += alignedSize;
+
+  return pMemory;
+}
+
+void destroyArena(struct Arena* pArena) {
+  if (pArena->pBase != NULL) {
+    munmap(pArena->pBase, pArena->Size);
+  }
+  pArena->pBase = NULL;
+  pArena->Size = 0;
+  pArena->Used = 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * A block of memory that is mapped and faulted in once at startup. Buffers that are written during the measurement
+ * are carved out of it, so that no page fault disturbs the measured transitions.
+ */
+struct Arena {
+  char* pBase;
+  size_t Size;
+  size_t Used;
+};
+
+/**
+ * Map and pre-fault the memory of the arena
+ * \param pArena the arena to create
+ * \param size the number of bytes that can be allocated from the arena
+ * \return 0 is everything gone fine
+ */
+char createArena(struct Arena* pArena, size_t size);
+
+/**
+ * Allocate zero initialized memory from the arena, aligned to a cache line
+ * \param pArena the arena to allocate from
+ * \param size the number of bytes to allocate
+ * \return the allocated memory, NULL if the arena is too small
+ */
+void* arenaAlloc(struct Arena* pArena, size_t size);
+
+/**
+ * The space that an allocation of \a size bytes takes in the arena, to size it at startup
+ */
+size_t arenaSize(size_t size);
+
+/**
+ * Unmap the memory of the arena
+ */
+void destroyArena(struct Arena* pArena);
+
+#endif
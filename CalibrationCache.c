@@ -0,0 +1,268 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CalibrationCache.h"
+#include "FreqGetter.h"
+#include "FreqSetter.h"
+
+#define CPU_INFO_FIELD_SIZE 128
+#define LOOP_NAME_SIZE 32
+#define TARGET_NAME_SIZE 16
+#define CACHE_LINE_SIZE 512
+
+struct CalibrationCacheEntry {
+  char Model[CPU_INFO_FIELD_SIZE];
+  char Microcode[CPU_INFO_FIELD_SIZE];
+  unsigned int CoreID;
+  char LoopName[LOOP_NAME_SIZE];
+  // What the frequency is the value of, e.g. core, uncore or epp, see getFreqSetterTargetName
+  char TargetName[TARGET_NAME_SIZE];
+  unsigned int Frequency;
+  struct ConfidenceInterval Interval;
+};
+
+struct CoreIdentity {
+  char Model[CPU_INFO_FIELD_SIZE];
+  char Microcode[CPU_INFO_FIELD_SIZE];
+};
+
+static char* pCacheFileName = NULL;
+static struct CalibrationCacheEntry* pEntries = NULL;
+static unsigned int nbEntries = 0;
+static unsigned int entriesCapacity = 0;
+static bool dirty = false;
+// Indexed by core ID
+static struct CoreIdentity* pCoreIdentities = NULL;
+static unsigned int nbCoreIdentities = 0;
+// The cache is shared by all measuring threads
+static pthread_mutex_t cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Read the model name and microcode revision of every core from /proc/cpuinfo, once for all the lookups
+ */
+static char readCoreIdentities(void) {
+  char line[CACHE_LINE_SIZE];
+  unsigned int processor = 0;
+  bool inCore = false;
+
+  nbCoreIdentities = getCoreNumber();
+  pCoreIdentities = malloc(sizeof(struct CoreIdentity) * nbCoreIdentities);
+  if (pCoreIdentities == NULL) {
+    fprintf(stderr, "Fail to allocate memory for the calibration cache\n");
+    return -1;
+  }
+  for (unsigned int i = 0; i < nbCoreIdentities; i++) {
+    strcpy(pCoreIdentities[i].Model, "unknown");
+    strcpy(pCoreIdentities[i].Microcode, "unknown");
+  }
+
+  FILE* pFile = fopen("/proc/cpuinfo", "r");
+  if (pFile == NULL) {
+    return 0;
+  }
+
+  while (fgets(line, sizeof(line), pFile) != NULL) {
+    char* pValue = strchr(line, ':');
+    if (pValue == NULL) {
+      continue;
+    }
+    pValue += 2;
+    pValue[strcspn(pValue, "\n")] = '\0';
+
+    if (strncmp(line, "processor", 9) == 0 && sscanf(pValue, "%u", &processor) == 1) {
+      inCore = processor < nbCoreIdentities;
+    } else if (inCore && strncmp(line, "model name", 10) == 0) {
+      snprintf(pCoreIdentities[processor].Model, CPU_INFO_FIELD_SIZE, "%s", pValue);
+    } else if (inCore && strncmp(line, "microcode", 9) == 0) {
+      snprintf(pCoreIdentities[processor].Microcode, CPU_INFO_FIELD_SIZE, "%s", pValue);
+    }
+  }
+
+  fclose(pFile);
+
+  return 0;
+}
+
+static struct CalibrationCacheEntry* findEntry(struct CalibrationCacheEntry const* Key) {
+  for (unsigned int i = 0; i < nbEntries; i++) {
+    struct CalibrationCacheEntry* pEntry = &pEntries[i];
+    if (pEntry->CoreID == Key->CoreID && pEntry->Frequency == Key->Frequency &&
+        strcmp(pEntry->LoopName, Key->LoopName) == 0 && strcmp(pEntry->TargetName, Key->TargetName) == 0 &&
+        strcmp(pEntry->Model, Key->Model) == 0 &&
+        strcmp(pEntry->Microcode, Key->Microcode) == 0) {
+      return pEntry;
+    }
+  }
+
+  return NULL;
+}
+
+static struct CalibrationCacheEntry* appendEntry() {
+  if (nbEntries == entriesCapacity) {
+    unsigned int newCapacity = entriesCapacity == 0 ? 64 : entriesCapacity * 2;
+    struct CalibrationCacheEntry* pNewEntries = realloc(pEntries, sizeof(struct CalibrationCacheEntry) * newCapacity);
+    if (pNewEntries == NULL) {
+      fprintf(stderr, "Fail to allocate memory for the calibration cache\n");
+      return NULL;
+    }
+    pEntries = pNewEntries;
+    entriesCapacity = newCapacity;
+  }
+
+  return &pEntries[nbEntries++];
+}
+
+static void buildKey(unsigned int coreID, const char* loopName, unsigned int freq, struct CalibrationCacheEntry* Key) {
+  struct CoreIdentity const* pIdentity = coreID < nbCoreIdentities ? &pCoreIdentities[coreID] : NULL;
+
+  snprintf(Key->Model, CPU_INFO_FIELD_SIZE, "%s", pIdentity != NULL ? pIdentity->Model : "unknown");
+  snprintf(Key->Microcode, CPU_INFO_FIELD_SIZE, "%s", pIdentity != NULL ? pIdentity->Microcode : "unknown");
+  Key->CoreID = coreID;
+  snprintf(Key->LoopName, LOOP_NAME_SIZE, "%s", loopName);
+  snprintf(Key->TargetName, TARGET_NAME_SIZE, "%s", getFreqSetterTargetName());
+  Key->Frequency = freq;
+}
+
+char openCalibrationCache(const char* pFileName) {
+  char line[CACHE_LINE_SIZE];
+
+  pCacheFileName = strdup(pFileName);
+  if (pCacheFileName == NULL) {
+    fprintf(stderr, "Fail to allocate memory for the calibration cache\n");
+    return -1;
+  }
+
+  if (readCoreIdentities() != 0) {
+    return -1;
+  }
+
+  FILE* pFile = fopen(pFileName, "r");
+  if (pFile == NULL) {
+    // The cache is created on close
+    return 0;
+  }
+
+  while (fgets(line, sizeof(line), pFile) != NULL) {
+    struct CalibrationCacheEntry Entry;
+    struct ConfidenceInterval* Interval = &Entry.Interval;
+
+    if (line[0] == '#') {
+      continue;
+    }
+
+    if (sscanf(line, "%127[^\t]\t%127[^\t]\t%u\t%31[^\t]\t%15[^\t]\t%u\t%u\t%lf\t%lf\t%lu\t%lu\t%lu\t%lu",
+               Entry.Model, Entry.Microcode, &Entry.CoreID, Entry.LoopName, Entry.TargetName, &Entry.Frequency,
+               &Interval->NbSamples, &Interval->Average, &Interval->StandardDeviation, &Interval->LowerBound,
+               &Interval->UpperBound, &Interval->Q1, &Interval->Q3) != 13) {
+      fprintf(stderr, "Skipping malformed calibration cache entry: %s", line);
+      continue;
+    }
+
+    struct CalibrationCacheEntry* pEntry = appendEntry();
+    if (pEntry == NULL) {
+      fclose(pFile);
+      return -1;
+    }
+    *pEntry = Entry;
+  }
+
+  fclose(pFile);
+
+  return 0;
+}
+
+bool lookupCalibration(unsigned int coreID, const char* loopName, unsigned int freq,
+                       struct ConfidenceInterval* Interval) {
+  struct CalibrationCacheEntry Key;
+
+  if (pCacheFileName == NULL) {
+    return false;
+  }
+
+  buildKey(coreID, loopName, freq, &Key);
+
+  pthread_mutex_lock(&cacheMutex);
+  struct CalibrationCacheEntry* pEntry = findEntry(&Key);
+  if (pEntry != NULL) {
+    *Interval = pEntry->Interval;
+    Interval->pHistogram = NULL;
+  }
+  pthread_mutex_unlock(&cacheMutex);
+
+  return pEntry != NULL;
+}
+
+void storeCalibration(unsigned int coreID, const char* loopName, unsigned int freq,
+                      struct ConfidenceInterval const* Interval) {
+  struct CalibrationCacheEntry Key;
+
+  if (pCacheFileName == NULL) {
+    return;
+  }
+
+  buildKey(coreID, loopName, freq, &Key);
+
+  pthread_mutex_lock(&cacheMutex);
+  struct CalibrationCacheEntry* pEntry = findEntry(&Key);
+  if (pEntry == NULL) {
+    pEntry = appendEntry();
+  }
+  if (pEntry != NULL) {
+    *pEntry = Key;
+    pEntry->Interval = *Interval;
+    dirty = true;
+  }
+  pthread_mutex_unlock(&cacheMutex);
+}
+
+void closeCalibrationCache(void) {
+  if (pCacheFileName != NULL && dirty) {
+    FILE* pFile = fopen(pCacheFileName, "w");
+    if (pFile == NULL) {
+      fprintf(stderr, "Fail to open %s\n", pCacheFileName);
+    } else {
+      fprintf(pFile, "# Model\tMicrocode\tCore\tLoop\tTarget\tFrequency\tSamples\tAverage\tStandard deviation\t"
+                     "Lower bound\tUpper bound\tQ1\tQ3\n");
+      for (unsigned int i = 0; i < nbEntries; i++) {
+        struct CalibrationCacheEntry const* pEntry = &pEntries[i];
+        struct ConfidenceInterval const* Interval = &pEntry->Interval;
+        fprintf(pFile, "%s\t%s\t%u\t%s\t%s\t%u\t%u\t%.17g\t%.17g\t%lu\t%lu\t%lu\t%lu\n", pEntry->Model,
+                pEntry->Microcode, pEntry->CoreID, pEntry->LoopName, pEntry->TargetName, pEntry->Frequency,
+                Interval->NbSamples, Interval->Average, Interval->StandardDeviation, Interval->LowerBound,
+                Interval->UpperBound, Interval->Q1, Interval->Q3);
+      }
+      fclose(pFile);
+    }
+  }
+
+  free(pEntries);
+  free(pCacheFileName);
+  free(pCoreIdentities);
+  pCoreIdentities = NULL;
+  nbCoreIdentities = 0;
+  pEntries = NULL;
+  pCacheFileName = NULL;
+  nbEntries = 0;
+  entriesCapacity = 0;
+  dirty = false;
+}
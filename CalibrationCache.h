@@ -0,0 +1,62 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALIBRATIONCACHE_H
+#define CALIBRATIONCACHE_H
+
+#include <stdbool.h>
+
+#include "ConfInterval.h"
+
+/**
+ * Open the calibration cache and load all entries stored in the file.
+ * A missing file is not an error, it is created when the cache is closed.
+ * \param pFileName the file holding the cache
+ * \return 0 is everything gone fine
+ */
+char openCalibrationCache(const char* pFileName);
+
+/**
+ * Look up the loop timing of a core at a frequency.
+ * Entries are keyed by the CPU model and microcode revision of the core, the core ID, the loop variant, what the
+ * setter backend sets (see getFreqSetterTargetName) and the frequency.
+ * \param coreID the id of the core
+ * \param loopName the name of the loop variant
+ * \param freq the frequency
+ * \param Interval where the cached interval is stored
+ * \return true if the cache holds an entry
+ */
+bool lookupCalibration(unsigned int coreID, const char* loopName, unsigned int freq,
+                       struct ConfidenceInterval* Interval);
+
+/**
+ * Store the loop timing of a core at a frequency, replacing any previous entry
+ * \param coreID the id of the core
+ * \param loopName the name of the loop variant
+ * \param freq the frequency
+ * \param Interval the interval to store
+ */
+void storeCalibration(unsigned int coreID, const char* loopName, unsigned int freq,
+                      struct ConfidenceInterval const* Interval);
+
+/**
+ * Write back the cache if it was modified and free its entries
+ */
+void closeCalibrationCache(void);
+
+#endif
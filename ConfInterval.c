@@ -23,21 +23,190 @@
 
 #include "ConfInterval.h"
 
+// The continued fraction of the incomplete beta function stops at this relative change or number of terms
+#define BETA_EPSILON 1e-12
+#define BETA_MAX_TERMS 300
+// The sums of buildFromMeasurement are spread over this many independent accumulators, one vector of doubles
+#define NB_SUM_LANES 4
+// The selection of the quartiles sorts ranges up to this size by insertion instead of partitioning them
+#define SELECT_INSERTION_SIZE 16
+
+static double confidenceLevel = CONFIDENCE_LEVEL;
+// Two-sided quantile of the standard normal distribution at confidenceLevel
+static double zValue = 1.959963984540054;
+
+/* Inverse of the standard normal distribution function, by bisection: it is only needed when the level is set */
+static double normalQuantile(double p) {
+  double low = -40;
+  double high = 40;
+
+  for (unsigned int i = 0; i < 200; i++) {
+    double middle = (low + high) / 2;
+    if (0.5 * erfc(-middle / M_SQRT2) < p) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+
+  return (low + high) / 2;
+}
+
+void setConfidenceLevel(double Level) {
+  assert(Level > 0 && Level < 1);
+  confidenceLevel = Level;
+  zValue = normalQuantile(1 - (1 - Level) / 2);
+}
+
+double getConfidenceLevel(void) {
+  return confidenceLevel;
+}
+
+/* Sum the samples and their squares in one pass. The values are shifted by the first sample so the squares do not
+ * cancel out, and each lane accumulates every NB_SUM_LANES-th sample so the additions vectorize. */
+static void sumMoments(unsigned int n, unsigned long const* times, double* pSum, double* pSumSquares) {
+  double shift = times[0];
+  double sums[NB_SUM_LANES] = {0};
+  double squares[NB_SUM_LANES] = {0};
+  unsigned int i = 0;
+
+  for (; i + NB_SUM_LANES <= n; i += NB_SUM_LANES) {
+    for (unsigned int lane = 0; lane < NB_SUM_LANES; lane++) {
+      double value = (double)times[i + lane] - shift;
+      sums[lane] += value;
+      squares[lane] += value * value;
+    }
+  }
+  for (; i < n; i++) {
+    double value = (double)times[i] - shift;
+    sums[0] += value;
+    squares[0] += value * value;
+  }
+
+  *pSum = 0;
+  *pSumSquares = 0;
+  for (unsigned int lane = 0; lane < NB_SUM_LANES; lane++) {
+    *pSum += sums[lane];
+    *pSumSquares += squares[lane];
+  }
+}
+
+static inline void swapTimes(unsigned long* a, unsigned long* b) {
+  unsigned long tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+/* Move the value of rank k of times[low..high] to times[k], smaller or equal values before it and greater or equal
+ * values after it. Quickselect with a median of three pivot, the small ranges are sorted by insertion. */
+static void selectRank(unsigned long* times, long low, long high, long k) {
+  while (high - low >= SELECT_INSERTION_SIZE) {
+    long mid = low + (high - low) / 2;
+    long i = low, j = high;
+    unsigned long pivot;
+
+    if (times[mid] < times[low]) {
+      swapTimes(&times[mid], &times[low]);
+    }
+    if (times[high] < times[low]) {
+      swapTimes(&times[high], &times[low]);
+    }
+    if (times[high] < times[mid]) {
+      swapTimes(&times[high], &times[mid]);
+    }
+    pivot = times[mid];
+
+    while (i <= j) {
+      while (times[i] < pivot) {
+        i++;
+      }
+      while (times[j] > pivot) {
+        j--;
+      }
+      if (i <= j) {
+        swapTimes(&times[i], &times[j]);
+        i++;
+        j--;
+      }
+    }
+
+    // times[j + 1 .. i - 1] all hold the pivot
+    if (k <= j) {
+      high = j;
+    } else if (k >= i) {
+      low = i;
+    } else {
+      return;
+    }
+  }
+
+  for (long i = low + 1; i <= high; i++) {
+    unsigned long value = times[i];
+    long j = i - 1;
+
+    for (; j >= low && times[j] > value; j--) {
+      times[j + 1] = times[j];
+    }
+    times[j + 1] = value;
+  }
+}
+
 void buildFromMeasurement(unsigned long* Times, unsigned int NbTimes, struct ConfidenceInterval* Interval) {
-  Interval->Average = average(NbTimes, Times);
-  Interval->StandardDeviation = sd(NbTimes, Interval->Average, Times);
+  double sum, sumSquares;
+  long q1Index = NbTimes / 4, q3Index = 3 * (long)NbTimes / 4;
+
+  sumMoments(NbTimes, Times, &sum, &sumSquares);
+
+  Interval->NbSamples = NbTimes;
+  Interval->Average = Times[0] + sum / NbTimes;
+  // The shifted sums can round the variance slightly below zero when all samples are equal
+  Interval->StandardDeviation = sqrt(fmax(0, (sumSquares - sum * sum / NbTimes) / (NbTimes - 1)));
 
   // Build the confidence interval for the target frequency
   confidenceInterval(NbTimes, Interval->Average, Interval->StandardDeviation, &Interval->LowerBound,
                      &Interval->UpperBound);
-  // Build the inter-quartile range for the target frequency
-  interQuartileRange(NbTimes, Times, &Interval->Q1, &Interval->Q3);
+  // Build the inter-quartile range for the target frequency, with the same indices as interQuartileRange. Q3 is
+  // selected among the values after Q1 only.
+  selectRank(Times, 0, NbTimes - 1, q1Index);
+  selectRank(Times, q1Index, NbTimes - 1, q3Index);
+  Interval->Q1 = Times[q1Index];
+  Interval->Q3 = Times[q3Index];
+  Interval->pHistogram = NULL;
+}
+
+void buildFromStreamingStats(struct StreamingStats const* Stats, struct ConfidenceInterval* Interval) {
+  unsigned int n = Stats->NbSamples;
+  unsigned long unused;
+
+  Interval->NbSamples = n;
+  Interval->Average = (double)Stats->Sum / n;
+  // The cancellation can round the variance slightly below zero when all samples are equal
+  double variance = (Stats->SumSquares - n * Interval->Average * Interval->Average) / (n - 1);
+  Interval->StandardDeviation = sqrt(fmax(0, variance));
+
+  // Build the confidence interval for the target frequency
+  confidenceInterval(n, Interval->Average, Interval->StandardDeviation, &Interval->LowerBound, &Interval->UpperBound);
+  // Build the inter-quartile range for the target frequency, with the same indices as interQuartileRange
+  streamingQuantile(Stats, n / 4, &Interval->Q1, &unused);
+  streamingQuantile(Stats, 3 * n / 4, &unused, &Interval->Q3);
+  Interval->pHistogram = NULL;
+}
+
+void dump(FILE* Out, struct ConfidenceInterval const* const Interval, int Frequency, const char* Name) {
+  fprintf(Out, "# Loop @ %s frequency %dHz took %.2f cycles\n", Name, Frequency, Interval->Average);
+  fprintf(Out, "# Calibrated with %u samples\n", Interval->NbSamples);
+  fprintf(Out, "# Interval [%lu ; %lu]\n", Interval->LowerBound, Interval->UpperBound);
+  fprintf(Out, "# Q1 : %lu ; Q3 : %lu\n", Interval->Q1, Interval->Q3);
 }
 
-void dump(struct ConfidenceInterval const* const Interval, int Frequency, const char* Name) {
-  fprintf(stdout, "# Loop @ %s frequency %dHz took %.2f cycles\n", Name, Frequency, Interval->Average);
-  fprintf(stdout, "# Interval [%lu ; %lu]\n", Interval->LowerBound, Interval->UpperBound);
-  fprintf(stdout, "# Q1 : %lu ; Q3 : %lu\n", Interval->Q1, Interval->Q3);
+static bool relativelyClose(double Lhs, double Rhs, double Tolerance) {
+  return fabs(Lhs - Rhs) <= Tolerance * fabs(Rhs);
+}
+
+bool converged(struct ConfidenceInterval const* const Lhs, struct ConfidenceInterval const* const Rhs,
+               double Tolerance) {
+  return relativelyClose(Lhs->Average, Rhs->Average, Tolerance) && relativelyClose(Lhs->Q1, Rhs->Q1, Tolerance) &&
+         relativelyClose(Lhs->Q3, Rhs->Q3, Tolerance);
 }
 
 bool overlap(struct ConfidenceInterval const* const Lhs, struct ConfidenceInterval const* const Rhs) {
@@ -56,6 +225,129 @@ bool overlapSignificantlyQ1Q3(struct ConfidenceInterval const* const Lhs, struct
   return (LhsQ1Q3 >= Rhs->Q1 && LhsQ1Q3 <= Rhs->Q3) || (RhsQ1Q3 >= Lhs->Q1 && RhsQ1Q3 <= Lhs->Q3);
 }
 
+/* Continued fraction of the regularized incomplete beta function, modified Lentz's method */
+static double betaContinuedFraction(double a, double b, double x) {
+  double c = 1;
+  double d = 1 - (a + b) * x / (a + 1);
+  d = 1 / (fabs(d) < 1e-300 ? 1e-300 : d);
+  double fraction = d;
+
+  for (unsigned int m = 1; m <= BETA_MAX_TERMS; m++) {
+    for (unsigned int odd = 0; odd < 2; odd++) {
+      double numerator = odd == 0 ? m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m))
+                                  : -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+      d = 1 + numerator * d;
+      d = 1 / (fabs(d) < 1e-300 ? 1e-300 : d);
+      c = 1 + numerator / c;
+      c = fabs(c) < 1e-300 ? 1e-300 : c;
+      fraction *= c * d;
+      if (odd == 1 && fabs(c * d - 1) < BETA_EPSILON) {
+        return fraction;
+      }
+    }
+  }
+
+  return fraction;
+}
+
+/* Regularized incomplete beta function I_x(a, b) */
+static double incompleteBeta(double a, double b, double x) {
+  if (x <= 0) {
+    return 0;
+  } else if (x >= 1) {
+    return 1;
+  }
+
+  double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1 - x));
+  // The continued fraction converges quickly below the mean of the distribution, the symmetry is used above
+  if (x < (a + 1) / (a + b + 2)) {
+    return front * betaContinuedFraction(a, b, x) / a;
+  }
+  return 1 - front * betaContinuedFraction(b, a, 1 - x) / b;
+}
+
+bool welchTest(struct ConfidenceInterval const* const Lhs, struct ConfidenceInterval const* const Rhs,
+               struct TestResult* Result) {
+  if (Lhs->NbSamples < 2 || Rhs->NbSamples < 2) {
+    return false;
+  }
+
+  double lhsError = Lhs->StandardDeviation * Lhs->StandardDeviation / Lhs->NbSamples;
+  double rhsError = Rhs->StandardDeviation * Rhs->StandardDeviation / Rhs->NbSamples;
+  if (lhsError + rhsError <= 0) {
+    // Constant samples: they differ for sure or not at all
+    bool equal = Lhs->Average == Rhs->Average;
+    Result->Statistic = equal ? 0 : copysign(INFINITY, Lhs->Average - Rhs->Average);
+    Result->PValue = equal ? 1 : 0;
+    return true;
+  }
+
+  // Welch-Satterthwaite degrees of freedom
+  double degrees = (lhsError + rhsError) * (lhsError + rhsError) /
+                   (lhsError * lhsError / (Lhs->NbSamples - 1) + rhsError * rhsError / (Rhs->NbSamples - 1));
+
+  Result->Statistic = (Lhs->Average - Rhs->Average) / sqrt(lhsError + rhsError);
+  // Two-sided p-value of Student's t distribution
+  Result->PValue = incompleteBeta(degrees / 2, 0.5, degrees / (degrees + Result->Statistic * Result->Statistic));
+
+  return true;
+}
+
+bool mannWhitneyTest(struct ConfidenceInterval const* const Lhs, struct ConfidenceInterval const* const Rhs,
+                     struct TestResult* Result) {
+  struct StreamingStats const* pLhs = Lhs->pHistogram;
+  struct StreamingStats const* pRhs = Rhs->pHistogram;
+
+  if (pLhs == NULL || pRhs == NULL || pLhs->NbSamples == 0 || pRhs->NbSamples == 0) {
+    return false;
+  }
+
+  double n1 = pLhs->NbSamples;
+  double n2 = pRhs->NbSamples;
+  double n = n1 + n2;
+  unsigned int firstBucket = pLhs->MinBucket < pRhs->MinBucket ? pLhs->MinBucket : pRhs->MinBucket;
+  unsigned int lastBucket = pLhs->MaxBucket > pRhs->MaxBucket ? pLhs->MaxBucket : pRhs->MaxBucket;
+  // Number of Rhs samples below the current bucket
+  double rhsBelow = 0;
+  double u = 0;
+  double ties = 0;
+
+  for (unsigned int bucket = firstBucket; bucket <= lastBucket; bucket++) {
+    double lhsCount = pLhs->Buckets[bucket];
+    double rhsCount = pRhs->Buckets[bucket];
+    double tied = lhsCount + rhsCount;
+
+    // Each Lhs sample wins against the smaller Rhs samples and half wins against the tied ones
+    u += lhsCount * (rhsBelow + rhsCount / 2);
+    rhsBelow += rhsCount;
+    ties += tied * tied * tied - tied;
+  }
+
+  double variance = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+  if (variance <= 0) {
+    // All the samples are in the same bucket
+    Result->Statistic = 0;
+    Result->PValue = 1;
+    return true;
+  }
+
+  Result->Statistic = (u - n1 * n2 / 2) / sqrt(variance);
+  Result->PValue = erfc(fabs(Result->Statistic) / M_SQRT2);
+
+  return true;
+}
+
+bool differSignificantly(struct ConfidenceInterval const* const Lhs, struct ConfidenceInterval const* const Rhs) {
+  struct TestResult Result;
+  double alpha = 1 - confidenceLevel;
+
+  if (!welchTest(Lhs, Rhs, &Result) || Result.PValue >= alpha) {
+    return false;
+  }
+
+  return !mannWhitneyTest(Lhs, Rhs, &Result) || Result.PValue < alpha;
+}
+
 /* Compute the average sample execution time */
 double average(unsigned int n, unsigned long* times) {
   unsigned int i = 0;
@@ -88,26 +380,9 @@ double sd(unsigned int n, double average, unsigned long* times) {
 
 void confidenceInterval(unsigned int n, double average, double sd, unsigned long* lowBoundTime,
                         unsigned long* highBoundTime) {
-  // Zp for 99.9% confidence
-  // float z_value = 3.291;
-  // Zp for 99% confidence
-  // float z_value = 2.346;
-  // Zp for 97.5% confidence
-  // float z_value = 2.257;
-  // A Zp value for 95% confidence level
-  float z_value = 1.960;
-  // at 90% confidence
-  // float z_value = 1.645;
-  // at 85% confidence
-  // float z_value = 1.440;
-  // at 80% confidence
-  // float z_value = 1.282;
-  // at 50%
-  // float z_value = 0.674;
-
   double standardError = 0.0;
 
-  standardError = (z_value * sd) / sqrt(n);
+  standardError = (zValue * sd) / sqrt(n);
 
   // printf("stderr = %f\n", standardError);
 
@@ -116,12 +391,12 @@ void confidenceInterval(unsigned int n, double average, double sd, unsigned long
 }
 
 int comparer(const void* a, const void* b) {
-  unsigned int uiA = *((unsigned int*)a);
-  unsigned int uiB = *((unsigned int*)b);
+  unsigned long ulA = *((const unsigned long*)a);
+  unsigned long ulB = *((const unsigned long*)b);
 
-  if (uiA < uiB) {
+  if (ulA < ulB) {
     return -1;
-  } else if (uiA == uiB) {
+  } else if (ulA == ulB) {
     return 0;
   }
   // else
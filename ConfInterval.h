@@ -20,18 +20,50 @@
 #define CONFINTERVAL_H
 
 #include <stdbool.h>
+#include <stdio.h>
+
+#include "StreamingStats.h"
 
 struct ConfidenceInterval {
+  unsigned int NbSamples;
   double Average;
   double StandardDeviation;
   unsigned long LowerBound;
   unsigned long UpperBound;
   unsigned long Q1;
   unsigned long Q3;
+  // Histogram of the samples, NULL if it is not kept (measured samples, cached calibrations)
+  struct StreamingStats const* pHistogram;
+};
+
+/*
+ * Outcome of a two-sided test of the hypothesis that two samples come from the same distribution
+ */
+struct TestResult {
+  // t for Welch's t-test, the normal approximation z of U for the Mann-Whitney U test
+  double Statistic;
+  double PValue;
 };
 
+// Default of the confidence level of the intervals and the tests
+#ifndef CONFIDENCE_LEVEL
+#define CONFIDENCE_LEVEL 0.95
+#endif
+
 /*
- * Build the confidence intervals from a measurement
+ * Set the confidence level of the confidence intervals and of the tests
+ * \arg Level The confidence level, between 0 and 1 exclusive
+ */
+void setConfidenceLevel(double Level);
+
+/*
+ * Get the confidence level of the confidence intervals and of the tests
+ */
+double getConfidenceLevel(void);
+
+/*
+ * Build the confidence intervals from a measurement, in one pass over the values and a selection of the quartiles.
+ * The values are reordered, not sorted.
  * \arg Times The pointer to the measurement values
  * \arg NbTimes The number of values in the Times pointer
  * \arg Interval The results of the intervals
@@ -39,9 +71,24 @@ struct ConfidenceInterval {
 void buildFromMeasurement(unsigned long* Times, unsigned int NbTimes, struct ConfidenceInterval* Interval);
 
 /*
- * Dump the Confidence interval to stdout
+ * Build the confidence intervals from streamed measurement values.
+ * The quartiles are widened to the bounds of the histogram buckets that hold them. The histogram is not kept, the
+ * caller sets pHistogram if it keeps a copy of the stats.
+ * \arg Stats The stats of the measurement values
+ * \arg Interval The results of the intervals
  */
-void dump(struct ConfidenceInterval const* const Interval, int Frequency, const char* Name);
+void buildFromStreamingStats(struct StreamingStats const* Stats, struct ConfidenceInterval* Interval);
+
+/*
+ * Dump the Confidence interval to the Out stream
+ */
+void dump(FILE* Out, struct ConfidenceInterval const* const Interval, int Frequency, const char* Name);
+
+/*
+ * Check if the average, Q1 and Q3 of two intervals differ by less than a relative tolerance
+ */
+bool converged(struct ConfidenceInterval const* const Lhs, struct ConfidenceInterval const* const Rhs,
+               double Tolerance);
 
 /*
  * Check if intervals overlap.
@@ -58,6 +105,29 @@ bool overlapSignificantly(struct ConfidenceInterval const* const Lhs, struct Con
  */
 bool overlapSignificantlyQ1Q3(struct ConfidenceInterval const* const Lhs, struct ConfidenceInterval const* const Rhs);
 
+/*
+ * Welch's t-test on the averages and standard deviations of two intervals
+ * \arg Result The t statistic and its p-value
+ * \return false if an interval has less than 2 samples
+ */
+bool welchTest(struct ConfidenceInterval const* const Lhs, struct ConfidenceInterval const* const Rhs,
+               struct TestResult* Result);
+
+/*
+ * Mann-Whitney U test on the histograms of two intervals, computed in one pass over their buckets. Values in the same
+ * bucket count as ties.
+ * \arg Result The normal approximation of U, corrected for ties, and its p-value
+ * \return false if an interval has no histogram
+ */
+bool mannWhitneyTest(struct ConfidenceInterval const* const Lhs, struct ConfidenceInterval const* const Rhs,
+                     struct TestResult* Result);
+
+/*
+ * Check if the samples of two intervals differ at the confidence level: Welch's t-test and, if the histograms are
+ * kept, the Mann-Whitney U test both reject that they come from the same distribution
+ */
+bool differSignificantly(struct ConfidenceInterval const* const Lhs, struct ConfidenceInterval const* const Rhs);
+
 double average(unsigned int n, unsigned long* times);
 double sd(unsigned int n, double average, unsigned long* times);
 void confidenceInterval(unsigned int n, double average, double sd, unsigned long* lowBoundTime,
@@ -17,15 +17,31 @@
  */
 
 #include <assert.h>
-#include <linux/perf_event.h>
+#include <cpuid.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
-#include <sys/syscall.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "FreqGetter.h"
+#include "FreqSetter.h"
+#include "PerfCounter.h"
+#include "Simulation.h"
+#include "rdtsc.h"
+#include "utils.h"
+
+// Step used to build the list of frequencies when scaling_available_frequencies is missing
+#define FREQ_RANGE_STEP 100000
+// Duration of a frequency probe of waitCurFreq, the cycles are read with rdpmc so it can be short
+#define FREQ_PROBE_US 10
+
+#ifndef KNOB_SETTLE_US
+// The frequency a knob value leads to is not known, waitCurFreq busy waits this long instead
+#define KNOB_SETTLE_US 10000
+#endif
 
 unsigned int getCoreNumber() {
   static unsigned int nbCore = 0;
@@ -42,12 +58,194 @@ unsigned int getCoreNumber() {
   return nbCore;
 }
 
-unsigned long long get_cycles(int fd) {
-  unsigned long long result;
-  size_t res = read(fd, &result, sizeof(unsigned long long));
-  if (res != sizeof(unsigned long long))
-    return !(0ULL);
-  return result;
+static int compareFreqs(const void* a, const void* b) {
+  unsigned int uiA = *((const unsigned int*)a);
+  unsigned int uiB = *((const unsigned int*)b);
+
+  return (uiA > uiB) - (uiA < uiB);
+}
+
+static unsigned int readFreqFile(unsigned int coreID, const char* fileName) {
+  unsigned int freq = 0;
+  FILE* pFile = openCPUFreqFile(coreID, fileName, "r");
+  if (pFile == NULL) {
+    return 0;
+  }
+
+  if (fscanf(pFile, "%u", &freq) != 1) {
+    freq = 0;
+  }
+  fclose(pFile);
+
+  return freq;
+}
+
+unsigned int getAvailableFrequencies(unsigned int coreID, unsigned int* pFreqs, unsigned int maxFreqs) {
+  char filePathBuffer[BUFFER_PATH_SIZE] = {'\0'};
+  unsigned int nbFreqs = 0;
+
+  cpuFreqFilePath(filePathBuffer, coreID, "scaling_available_frequencies");
+
+  if (access(filePathBuffer, R_OK) == 0) {
+    FILE* pFile = openCPUFreqFile(coreID, "scaling_available_frequencies", "r");
+    if (pFile == NULL) {
+      return 0;
+    }
+
+    while (nbFreqs < maxFreqs && fscanf(pFile, "%u", &pFreqs[nbFreqs]) == 1) {
+      nbFreqs++;
+    }
+    fclose(pFile);
+  } else {
+    unsigned int minFreq = readFreqFile(coreID, "scaling_min_freq");
+    unsigned int maxFreq = readFreqFile(coreID, "scaling_max_freq");
+
+    for (unsigned int freq = minFreq; minFreq != 0 && freq <= maxFreq && nbFreqs < maxFreqs;
+         freq += FREQ_RANGE_STEP) {
+      pFreqs[nbFreqs++] = freq;
+    }
+  }
+
+  qsort(pFreqs, nbFreqs, sizeof(unsigned int), compareFreqs);
+
+  return nbFreqs;
+}
+
+/*
+ * Read a frequency from the uncore directory of the die of a core
+ * \return the frequency, 0 on failure
+ */
+static unsigned int readUncoreFreqFile(unsigned int coreID, const char* fileName) {
+  char freqBuffer[16] = {'\0'};
+  unsigned int freq = 0;
+  int fd = openUncoreFd(coreID, fileName, O_RDONLY);
+  if (fd < 0) {
+    return 0;
+  }
+
+  if (read(fd, freqBuffer, sizeof(freqBuffer) - 1) <= 0 || sscanf(freqBuffer, "%u", &freq) != 1) {
+    freq = 0;
+  }
+  close(fd);
+
+  return freq;
+}
+
+unsigned int getAvailableUncoreFrequencies(unsigned int coreID, unsigned int* pFreqs, unsigned int maxFreqs) {
+  unsigned int minFreq = readUncoreFreqFile(coreID, "initial_min_freq_khz");
+  unsigned int maxFreq = readUncoreFreqFile(coreID, "initial_max_freq_khz");
+  unsigned int nbFreqs = 0;
+
+  for (unsigned int freq = minFreq; minFreq != 0 && freq <= maxFreq && nbFreqs < maxFreqs; freq += FREQ_RANGE_STEP) {
+    pFreqs[nbFreqs++] = freq;
+  }
+
+  return nbFreqs;
+}
+
+/*
+ * Wait for the uncore of the die of a core to run at a frequency, current_freq_khz is polled
+ */
+static void waitUncoreFreq(unsigned int coreID, unsigned int targetFreq) {
+  char filePathBuffer[BUFFER_PATH_SIZE] = {'\0'};
+  unsigned int measuredFreq = 0;
+  int nr = 0;
+
+  uncoreFilePath(filePathBuffer, coreID, "current_freq_khz");
+  if (access(filePathBuffer, R_OK) != 0) {
+    fprintf(stderr, "Fail to read %s, not waiting for %u\n", filePathBuffer, targetFreq);
+    return;
+  }
+
+  while ((measuredFreq = readUncoreFreqFile(coreID, "current_freq_khz")) != targetFreq) {
+    if ((nr++ % 1000) == 900) {
+      printf("Target: %u, measured: %u\n", targetFreq, measuredFreq);
+    }
+  }
+}
+
+// Duration of the TSC frequency measurement
+#define TSC_MEASUREMENT_NS 50000000
+
+static unsigned long tscFrequency = 0;
+static const char* tscFrequencySource = "measured";
+static pthread_once_t tscFrequencyOnce = PTHREAD_ONCE_INIT;
+
+static unsigned long long getnsec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return (unsigned long long)ts.tv_nsec + (unsigned long long)ts.tv_sec * 1000000000;
+}
+
+/*
+ * The TSC frequency enumerated by CPUID: leaf 0x15 gives the ratio of the TSC to the core crystal clock and the
+ * crystal frequency, when the crystal frequency is missing the TSC runs at the base frequency of leaf 0x16
+ * \return 0 if CPUID does not enumerate it, e.g. on AMD or under most hypervisors
+ */
+static unsigned long cpuidTscFrequency() {
+  unsigned int maxLeaf = __get_cpuid_max(0, NULL);
+  unsigned int denominator, numerator, crystalHz, edx;
+  unsigned int baseMHz, ebx, ecx;
+
+  if (maxLeaf < 0x15) {
+    return 0;
+  }
+  __cpuid(0x15, denominator, numerator, crystalHz, edx);
+  if (denominator == 0 || numerator == 0) {
+    return 0;
+  }
+  if (crystalHz != 0) {
+    tscFrequencySource = "CPUID 0x15";
+    return (unsigned long)crystalHz * numerator / denominator;
+  }
+
+  if (maxLeaf < 0x16) {
+    return 0;
+  }
+  __cpuid(0x16, baseMHz, ebx, ecx, edx);
+  if ((baseMHz & 0xFFFF) == 0) {
+    return 0;
+  }
+  tscFrequencySource = "CPUID 0x16";
+  return (unsigned long)(baseMHz & 0xFFFF) * 1000000;
+}
+
+static void measureTscFrequency() {
+  unsigned long beforeCycles, afterCycles;
+  unsigned long long beforeTime, afterTime;
+
+  beforeTime = getnsec();
+  sync_rdtsc1(beforeCycles);
+  do {
+    afterTime = getnsec();
+  } while (afterTime - beforeTime < TSC_MEASUREMENT_NS);
+  sync_rdtsc2(afterCycles);
+
+  tscFrequency = (double)(afterCycles - beforeCycles) * 1e9 / (afterTime - beforeTime);
+}
+
+static void detectTscFrequency() {
+  tscFrequency = cpuidTscFrequency();
+  if (tscFrequency == 0) {
+    measureTscFrequency();
+  }
+}
+
+unsigned long getTscFrequency() {
+  pthread_once(&tscFrequencyOnce, detectTscFrequency);
+  return tscFrequency;
+}
+
+const char* getTscFrequencySource() {
+  pthread_once(&tscFrequencyOnce, detectTscFrequency);
+  return tscFrequencySource;
+}
+
+bool isTscInvariant() {
+  unsigned int eax, ebx, ecx, edx;
+
+  // Invariant TSC, CPUID 0x80000007 EDX bit 8
+  return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) != 0 && (edx & (1U << 8)) != 0;
 }
 
 unsigned long long getusec() {
@@ -59,36 +257,62 @@ unsigned long long getusec() {
 void waitCurFreq(unsigned int coreID, unsigned int targetFreq) {
   assert(coreID < getCoreNumber());
 
-  struct perf_event_attr attr;
+  // The counter counts the calling thread while it runs on coreID, the thread is pinned to it
+  static __thread struct PerfCounter cycles = {.Fd = -1, .pPage = NULL};
+  static __thread unsigned int cyclesCoreID = 0;
   int nr = 0;
-  static int fd = 0;
-  unsigned long long before_cycles, after_cycles, before_time, after_time;
+  unsigned long before_cycles, after_cycles, before_time, after_time;
   unsigned int measuredFreq;
 
+  if (simulationEnabled()) {
+    waitSimulatedFreq(coreID, targetFreq);
+    return;
+  } else if (getFreqSetterBackend() == FREQ_SETTER_UNCORE) {
+    waitUncoreFreq(coreID, targetFreq);
+    return;
+  } else if (isKnobBackend(getFreqSetterBackend())) {
+    unsigned long startTime = 0;
+    unsigned long currentTime = 0;
+
+    sync_rdtsc1(startTime);
+    do {
+      sync_rdtsc1(currentTime);
+    } while (currentTime - startTime < getTscFrequency() / 1000000 * KNOB_SETTLE_US);
+    return;
+  }
+
   // set up performance counter
-  if (fd == 0) {
-    memset(&attr, 0, sizeof(struct perf_event_attr));
-    attr.type = PERF_TYPE_HARDWARE;
-    attr.config = PERF_COUNT_HW_CPU_CYCLES;
-    fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  if (cycles.Fd >= 0 && cyclesCoreID != coreID) {
+    closePerfCounter(&cycles);
   }
+  if (cycles.Fd < 0) {
+    if (openPerfCounter(&cycles, coreID, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES) != 0) {
+      fprintf(stderr, "Fail to open the cycle counter, not waiting for %u\n", targetFreq);
+      return;
+    }
+    cyclesCoreID = coreID;
+  }
+
+  unsigned long probeCycles = getTscFrequency() / 1000000 * FREQ_PROBE_US;
+
   // until target frequency is set
   while (1) {
-    before_time = getusec();
-    before_cycles = get_cycles(fd);
-    // measure 50 us
+    sync_rdtsc1(before_time);
+    before_cycles = readPerfCounter(&cycles);
+    // measure FREQ_PROBE_US us
     do {
-      after_time = getusec();
-    } while ((after_time - before_time) < 50);
+      sync_rdtsc1(after_time);
+    } while ((after_time - before_time) < probeCycles);
 
-    after_cycles = get_cycles(fd);
+    after_cycles = readPerfCounter(&cycles);
 
-    measuredFreq = (after_cycles - before_cycles) * 20;
+    // in kHz, like the cpufreq files
+    measuredFreq = (double)(after_cycles - before_cycles) * getTscFrequency() / 1000 / (after_time - before_time);
 
     // allow 5 % difference
     if (((double)measuredFreq / (double)targetFreq) > 0.95 && ((double)measuredFreq / (double)targetFreq) < 1.05)
       break;
-    else if ((nr % 1000) == 900)
+    else if ((nr++ % 1000) == 900)
       printf("Target: %u, measured: %u\n", targetFreq, measuredFreq);
   }
-}
\ No newline at end of file
+}
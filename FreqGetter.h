@@ -19,6 +19,8 @@
 #ifndef FREQGETTER_H
 #define FREQGETTER_H
 
+#include <stdbool.h>
+
 /**
  * Get the number of online cores
  * \return
@@ -26,12 +28,53 @@
 unsigned int getCoreNumber();
 
 /**
- * Wait the core identified by \a coreID to be at \a targetFreq frequency
+ * Wait the core identified by \a coreID to be at \a targetFreq frequency.
+ * With the uncore setter backend, wait for the uncore of its die instead.
+ * With the knob setter backends, the frequency is not known and KNOB_SETTLE_US are waited instead.
  * \param coreID core identifier
  * \param targetFreq
  */
 void waitCurFreq(unsigned int coreID, unsigned int targetFreq);
 
+/**
+ * Get the frequencies a core can be set to, sorted in ascending order.
+ * The list is read from scaling_available_frequencies. If this file does not exist (e.g. with intel_pstate), the
+ * range from scaling_min_freq to scaling_max_freq is returned in steps of 100 MHz.
+ * \param coreID core identifier
+ * \param pFreqs the array where the frequencies are stored
+ * \param maxFreqs the capacity of \a pFreqs
+ * \return the number of frequencies stored in \a pFreqs, 0 on failure
+ */
+unsigned int getAvailableFrequencies(unsigned int coreID, unsigned int* pFreqs, unsigned int maxFreqs);
+
+/**
+ * Get the uncore frequencies of the die of a core, from initial_min_freq_khz to initial_max_freq_khz in steps of
+ * 100 MHz
+ * \param coreID core identifier
+ * \param pFreqs the array where the frequencies are stored
+ * \param maxFreqs the capacity of \a pFreqs
+ * \return the number of frequencies stored in \a pFreqs, 0 on failure
+ */
+unsigned int getAvailableUncoreFrequencies(unsigned int coreID, unsigned int* pFreqs, unsigned int maxFreqs);
+
+/**
+ * Get the frequency of the time stamp counter, detected on the first call: read from CPUID leaf 0x15 (and 0x16) when
+ * the CPU enumerates it, measured against CLOCK_MONOTONIC_RAW otherwise
+ * \return the number of TSC cycles per second
+ */
+unsigned long getTscFrequency();
+
+/**
+ * Tell where the TSC frequency comes from
+ * \return "CPUID 0x15", "CPUID 0x16" or "measured"
+ */
+const char* getTscFrequencySource();
+
+/**
+ * Tell if the TSC runs at a constant rate in all the frequencies and C-states, so that its cycles are time
+ */
+bool isTscInvariant();
+
 /**
  * Get current usec in UNIX time
  */
@@ -17,20 +17,116 @@
  */
 
 #include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "FreqGetter.h"
 #include "FreqSetter.h"
+#include "Simulation.h"
 #include "utils.h"
 
+// Large enough for the decimal representation of any unsigned int and the names of the EPP values
+#define FREQ_STRING_SIZE 32
+
+/*
+ * A frequency formatted for the setter file
+ */
+struct FreqString {
+  unsigned int Freq;
+  unsigned int Length;
+  char Text[FREQ_STRING_SIZE];
+};
+
+/*
+ * A value of a knob that is written as its name
+ */
+struct KnobName {
+  const char* Name;
+  unsigned int Value;
+};
+
+// The values the kernel maps the energy_performance_preference strings to without firmware defaults
+static const struct KnobName eppNames[] = {
+    {"performance", 0},
+    {"balance_performance", 128},
+    {"balance_power", 192},
+    {"power", 255},
+};
+
+static enum FreqSetterBackend setterBackend = FREQ_SETTER_PWRITE;
 FILE** pMaxSetFiles = NULL;
+static int* pMaxSetFds = NULL;
+// The uncore backend writes both limits, pMaxSetFds holds the max_freq_khz files
+static int* pUncoreMinFds = NULL;
+// The min_freq_khz last written for each core
+static unsigned int* pUncoreMinFreqs = NULL;
+// The max_freq_khz and min_freq_khz of each core found at open, written back at close
+static struct FreqString* pSavedUncoreMaxs = NULL;
+static struct FreqString* pSavedUncoreMins = NULL;
+// The knobs of intel_pstate shared by all the cores: max_perf_pct or boost, and min_perf_pct
+static int knobFd = -1;
+static int knobMinFd = -1;
+// The min_perf_pct last written
+static unsigned int knobMin = 0;
+// boost is written to intel_pstate/no_turbo
+static bool invertBoost = false;
+// The knob values found at open, written back at close: energy_performance_preference of each core, max_perf_pct or
+// boost, and min_perf_pct
+static struct FreqString* pSavedEpps = NULL;
+static struct FreqString savedKnob = {0};
+static struct FreqString savedKnobMin = {0};
+// Sorted by frequency
+static struct FreqString* pFreqStrings = NULL;
+static unsigned int nbFreqStrings = 0;
 
-char openFreqSetterFiles() {
-  unsigned int nbCore = getCoreNumber();
+static const char* eppName(unsigned int value) {
+  for (unsigned int i = 0; i < sizeof(eppNames) / sizeof(eppNames[0]); i++) {
+    if (eppNames[i].Value == value) {
+      return eppNames[i].Name;
+    }
+  }
+  return NULL;
+}
+
+static void formatFreq(struct FreqString* pString, unsigned int freq) {
+  const char* pName = setterBackend == FREQ_SETTER_EPP ? eppName(freq) : NULL;
+
+  pString->Freq = freq;
+  if (pName != NULL) {
+    pString->Length = snprintf(pString->Text, FREQ_STRING_SIZE, "%s", pName);
+  } else {
+    pString->Length = snprintf(pString->Text, FREQ_STRING_SIZE, "%u", invertBoost ? !freq : freq);
+  }
+}
+
+static int compareFreqStrings(const void* lhs, const void* rhs) {
+  unsigned int lhsFreq = ((const struct FreqString*)lhs)->Freq;
+  unsigned int rhsFreq = ((const struct FreqString*)rhs)->Freq;
+  return (lhsFreq > rhsFreq) - (lhsFreq < rhsFreq);
+}
+
+static struct FreqString const* findFreqString(unsigned int freq) {
+  unsigned int low = 0;
+  unsigned int high = nbFreqStrings;
+
+  while (low < high) {
+    unsigned int middle = (low + high) / 2;
+    if (pFreqStrings[middle].Freq < freq) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
 
-  pMaxSetFiles = malloc(sizeof(FILE*) * nbCore);
+  return low < nbFreqStrings && pFreqStrings[low].Freq == freq ? &pFreqStrings[low] : NULL;
+}
+
+static char openStdioFiles(const char* fileName, unsigned int nbCore) {
+  pMaxSetFiles = calloc(nbCore, sizeof(FILE*));
 
   if (pMaxSetFiles == NULL) {
     fprintf(stdout, "Fail to allocate memory for files\n");
@@ -39,7 +135,7 @@ char openFreqSetterFiles() {
 
   unsigned int i = 0;
   for (i = 0; i < nbCore; i++) {
-    pMaxSetFiles[i] = openCPUFreqFile(i, FREQ_SETTER_FILE, "w");
+    pMaxSetFiles[i] = openCPUFreqFile(i, fileName, "w");
     if (pMaxSetFiles[i] == NULL) {
       return -1;
     }
@@ -48,17 +144,371 @@ char openFreqSetterFiles() {
   return 0;
 }
 
+/*
+ * Allocate the descriptor array of each core, all set to -1
+ */
+static int* allocateFds(unsigned int nbCore) {
+  int* pFds = malloc(sizeof(int) * nbCore);
+
+  for (unsigned int i = 0; pFds != NULL && i < nbCore; i++) {
+    pFds[i] = -1;
+  }
+
+  return pFds;
+}
+
+static void closeFds(int* pFds, unsigned int nbCore) {
+  for (unsigned int i = 0; pFds != NULL && i < nbCore; i++) {
+    if (pFds[i] >= 0) {
+      close(pFds[i]);
+    }
+  }
+  free(pFds);
+}
+
+/*
+ * Format every frequency that is requested during the measurement
+ */
+static char formatFreqs(unsigned int const* pFreqs, unsigned int nbFreqs) {
+  pFreqStrings = malloc(sizeof(struct FreqString) * (nbFreqs > 0 ? nbFreqs : 1));
+  if (pFreqStrings == NULL) {
+    fprintf(stdout, "Fail to allocate memory for files\n");
+    return -1;
+  }
+
+  for (unsigned int i = 0; i < nbFreqs; i++) {
+    formatFreq(&pFreqStrings[i], pFreqs[i]);
+  }
+  nbFreqStrings = nbFreqs;
+  qsort(pFreqStrings, nbFreqStrings, sizeof(struct FreqString), compareFreqStrings);
+
+  return 0;
+}
+
+static char openPwriteFiles(const char* fileName, int flags, unsigned int nbCore, unsigned int const* pFreqs,
+                            unsigned int nbFreqs) {
+  pMaxSetFds = allocateFds(nbCore);
+
+  if (pMaxSetFds == NULL) {
+    fprintf(stdout, "Fail to allocate memory for files\n");
+    return -1;
+  }
+
+  for (unsigned int i = 0; i < nbCore; i++) {
+    pMaxSetFds[i] = openCPUFreqFd(i, fileName, flags);
+    if (pMaxSetFds[i] < 0) {
+      return -1;
+    }
+  }
+
+  return formatFreqs(pFreqs, nbFreqs);
+}
+
+/*
+ * Read the text of a knob or limit file without its end of line, to write it back at close
+ */
+static char saveFdString(int fd, struct FreqString* pString) {
+  ssize_t length = pread(fd, pString->Text, FREQ_STRING_SIZE - 1, 0);
+
+  while (length > 0 && (pString->Text[length - 1] == '\n' || pString->Text[length - 1] == ' ')) {
+    length--;
+  }
+  if (length <= 0) {
+    pString->Length = 0;
+    return -1;
+  }
+
+  pString->Text[length] = '\0';
+  pString->Length = length;
+  if (sscanf(pString->Text, "%u", &pString->Freq) != 1) {
+    pString->Freq = 0;
+  }
+  return 0;
+}
+
+static char openEppFiles(unsigned int nbCore, unsigned int const* pFreqs, unsigned int nbFreqs) {
+  if (openPwriteFiles("energy_performance_preference", O_RDWR, nbCore, pFreqs, nbFreqs) != 0) {
+    return -1;
+  }
+
+  pSavedEpps = calloc(nbCore, sizeof(struct FreqString));
+  if (pSavedEpps == NULL) {
+    fprintf(stdout, "Fail to allocate memory for files\n");
+    return -1;
+  }
+
+  for (unsigned int i = 0; i < nbCore; i++) {
+    if (saveFdString(pMaxSetFds[i], &pSavedEpps[i]) != 0) {
+      fprintf(stderr, "Fail to read the energy_performance_preference of core %u\n", i);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static char openUncoreFiles(unsigned int nbCore, unsigned int const* pFreqs, unsigned int nbFreqs) {
+  pMaxSetFds = allocateFds(nbCore);
+  pUncoreMinFds = allocateFds(nbCore);
+  pUncoreMinFreqs = calloc(nbCore, sizeof(unsigned int));
+  pSavedUncoreMaxs = calloc(nbCore, sizeof(struct FreqString));
+  pSavedUncoreMins = calloc(nbCore, sizeof(struct FreqString));
+
+  if (pMaxSetFds == NULL || pUncoreMinFds == NULL || pUncoreMinFreqs == NULL || pSavedUncoreMaxs == NULL ||
+      pSavedUncoreMins == NULL) {
+    fprintf(stdout, "Fail to allocate memory for files\n");
+    return -1;
+  }
+
+  for (unsigned int i = 0; i < nbCore; i++) {
+    pMaxSetFds[i] = openUncoreFd(i, "max_freq_khz", O_RDWR);
+    pUncoreMinFds[i] = openUncoreFd(i, "min_freq_khz", O_RDWR);
+    if (pMaxSetFds[i] < 0 || pUncoreMinFds[i] < 0) {
+      return -1;
+    }
+
+    // The order of the two writes of setFreq depends on the current minimum
+    if (saveFdString(pMaxSetFds[i], &pSavedUncoreMaxs[i]) != 0 ||
+        saveFdString(pUncoreMinFds[i], &pSavedUncoreMins[i]) != 0) {
+      fprintf(stderr, "Fail to read the uncore frequency limits of core %u\n", i);
+      return -1;
+    }
+    pUncoreMinFreqs[i] = pSavedUncoreMins[i].Freq;
+  }
+
+  return formatFreqs(pFreqs, nbFreqs);
+}
+
+static char openPerfPctFiles(unsigned int const* pFreqs, unsigned int nbFreqs) {
+  knobFd = openCpuRootFd("intel_pstate/max_perf_pct", O_RDWR);
+  knobMinFd = openCpuRootFd("intel_pstate/min_perf_pct", O_RDWR);
+  if (knobFd < 0 || knobMinFd < 0) {
+    return -1;
+  }
+
+  if (saveFdString(knobFd, &savedKnob) != 0 || saveFdString(knobMinFd, &savedKnobMin) != 0) {
+    fprintf(stderr, "Fail to read min_perf_pct and max_perf_pct\n");
+    return -1;
+  }
+  knobMin = savedKnobMin.Freq;
+
+  return formatFreqs(pFreqs, nbFreqs);
+}
+
+static char openBoostFile(unsigned int const* pFreqs, unsigned int nbFreqs) {
+  char filePathBuffer[BUFFER_PATH_SIZE] = {'\0'};
+
+  // intel_pstate in active mode has no cpufreq/boost
+  cpuRootFilePath(filePathBuffer, "cpufreq/boost");
+  invertBoost = access(filePathBuffer, F_OK) != 0;
+  knobFd = openCpuRootFd(invertBoost ? "intel_pstate/no_turbo" : "cpufreq/boost", O_RDWR);
+  if (knobFd < 0) {
+    return -1;
+  }
+
+  if (saveFdString(knobFd, &savedKnob) != 0) {
+    fprintf(stderr, "Fail to read %s\n", invertBoost ? "no_turbo" : "boost");
+    return -1;
+  }
+
+  return formatFreqs(pFreqs, nbFreqs);
+}
+
+static void writeFreqString(int fd, struct FreqString const* pString) {
+  if (pwrite(fd, pString->Text, pString->Length, 0) != (ssize_t)pString->Length) {
+    perror("pwrite");
+  }
+}
+
+/*
+ * Write the same value to a minimum and a maximum, the minimum can never be above the maximum: when going up the
+ * maximum is raised first, when going down the minimum is lowered first
+ */
+static void writeLimits(int minFd, int maxFd, unsigned int* pMin, struct FreqString const* pString) {
+  if (pString->Freq >= *pMin) {
+    writeFreqString(maxFd, pString);
+    writeFreqString(minFd, pString);
+  } else {
+    writeFreqString(minFd, pString);
+    writeFreqString(maxFd, pString);
+  }
+  *pMin = pString->Freq;
+}
+
+char openFreqSetterFiles(const char* fileName, enum FreqSetterBackend backend, unsigned int const* pFreqs,
+                         unsigned int nbFreqs) {
+  unsigned int nbCore = getCoreNumber();
+
+  setterBackend = backend;
+  if (backend == FREQ_SETTER_SIMULATED) {
+    return 0;
+  } else if (backend == FREQ_SETTER_UNCORE) {
+    return openUncoreFiles(nbCore, pFreqs, nbFreqs);
+  } else if (backend == FREQ_SETTER_EPP) {
+    return openEppFiles(nbCore, pFreqs, nbFreqs);
+  } else if (backend == FREQ_SETTER_PERF_PCT) {
+    return openPerfPctFiles(pFreqs, nbFreqs);
+  } else if (backend == FREQ_SETTER_BOOST) {
+    return openBoostFile(pFreqs, nbFreqs);
+  } else if (backend == FREQ_SETTER_STDIO) {
+    return openStdioFiles(fileName, nbCore);
+  }
+  return openPwriteFiles(fileName, O_WRONLY, nbCore, pFreqs, nbFreqs);
+}
+
 void setFreq(unsigned int coreID, unsigned int targetFreq) {
   assert(coreID < getCoreNumber());
 
-  fprintf(pMaxSetFiles[coreID], "%d", targetFreq);
-  fflush(pMaxSetFiles[coreID]);
+  if (setterBackend == FREQ_SETTER_SIMULATED) {
+    requestSimulatedFreq(coreID, targetFreq);
+    return;
+  } else if (setterBackend == FREQ_SETTER_STDIO) {
+    fprintf(pMaxSetFiles[coreID], "%d", targetFreq);
+    fflush(pMaxSetFiles[coreID]);
+    return;
+  }
+
+  struct FreqString formatted;
+  struct FreqString const* pString = findFreqString(targetFreq);
+  if (pString == NULL) {
+    formatFreq(&formatted, targetFreq);
+    pString = &formatted;
+  }
+
+  if (setterBackend == FREQ_SETTER_UNCORE) {
+    writeLimits(pUncoreMinFds[coreID], pMaxSetFds[coreID], &pUncoreMinFreqs[coreID], pString);
+    return;
+  } else if (setterBackend == FREQ_SETTER_PERF_PCT) {
+    writeLimits(knobMinFd, knobFd, &knobMin, pString);
+    return;
+  } else if (setterBackend == FREQ_SETTER_BOOST) {
+    writeFreqString(knobFd, pString);
+    return;
+  }
+
+  writeFreqString(pMaxSetFds[coreID], pString);
+}
+
+enum FreqSetterBackend getFreqSetterBackend(void) {
+  return setterBackend;
+}
+
+bool isKnobBackend(enum FreqSetterBackend backend) {
+  return backend == FREQ_SETTER_EPP || isGlobalKnobBackend(backend);
+}
+
+bool isGlobalKnobBackend(enum FreqSetterBackend backend) {
+  return backend == FREQ_SETTER_PERF_PCT || backend == FREQ_SETTER_BOOST;
+}
+
+const char* getKnobName(void) {
+  switch (setterBackend) {
+  case FREQ_SETTER_EPP:
+    return "energy_performance_preference";
+  case FREQ_SETTER_PERF_PCT:
+    return "min_perf_pct and max_perf_pct";
+  case FREQ_SETTER_BOOST:
+    return invertBoost ? "boost (inverse of no_turbo)" : "boost";
+  default:
+    return NULL;
+  }
+}
+
+const char* getFreqSetterTargetName(void) {
+  switch (setterBackend) {
+  case FREQ_SETTER_SIMULATED:
+    return "simulated";
+  case FREQ_SETTER_UNCORE:
+    return "uncore";
+  case FREQ_SETTER_EPP:
+    return "epp";
+  case FREQ_SETTER_PERF_PCT:
+    return "perf-pct";
+  case FREQ_SETTER_BOOST:
+    return "boost";
+  default:
+    return "core";
+  }
+}
+
+char parseKnobValue(enum FreqSetterBackend backend, const char* pText, unsigned int* pValue) {
+  unsigned int maxValue = UINT_MAX;
+
+  if (backend == FREQ_SETTER_EPP) {
+    for (unsigned int i = 0; i < sizeof(eppNames) / sizeof(eppNames[0]); i++) {
+      if (strcmp(pText, eppNames[i].Name) == 0) {
+        *pValue = eppNames[i].Value;
+        return 0;
+      }
+    }
+    maxValue = 255;
+  } else if (backend == FREQ_SETTER_PERF_PCT) {
+    maxValue = 100;
+  } else if (backend == FREQ_SETTER_BOOST) {
+    maxValue = 1;
+  }
+
+  int nbRead = 0;
+  return sscanf(pText, "%u%n", pValue, &nbRead) == 1 && pText[nbRead] == '\0' && *pValue <= maxValue ? 0 : -1;
+}
+
+/*
+ * Write back a minimum and a maximum saved at open, in the order that keeps the minimum below the maximum
+ */
+static void restoreLimits(int minFd, int maxFd, unsigned int currentMin, struct FreqString const* pSavedMin,
+                          struct FreqString const* pSavedMax) {
+  if (pSavedMin->Length == 0 || pSavedMax->Length == 0 || minFd < 0 || maxFd < 0) {
+    return;
+  }
+
+  if (pSavedMin->Freq > currentMin) {
+    writeFreqString(maxFd, pSavedMax);
+    writeFreqString(minFd, pSavedMin);
+  } else {
+    writeFreqString(minFd, pSavedMin);
+    writeFreqString(maxFd, pSavedMax);
+  }
+}
+
+/*
+ * Write back the knob values and the uncore limits saved at open
+ */
+static void restoreKnobs(unsigned int nbCore) {
+  for (unsigned int i = 0; pSavedEpps != NULL && pMaxSetFds != NULL && i < nbCore; i++) {
+    if (pSavedEpps[i].Length > 0 && pMaxSetFds[i] >= 0) {
+      writeFreqString(pMaxSetFds[i], &pSavedEpps[i]);
+    }
+  }
+
+  if (pSavedUncoreMins != NULL && pSavedUncoreMaxs != NULL && pUncoreMinFreqs != NULL && pUncoreMinFds != NULL &&
+      pMaxSetFds != NULL) {
+    for (unsigned int i = 0; i < nbCore; i++) {
+      restoreLimits(pUncoreMinFds[i], pMaxSetFds[i], pUncoreMinFreqs[i], &pSavedUncoreMins[i], &pSavedUncoreMaxs[i]);
+    }
+  }
+
+  if (savedKnobMin.Length > 0) {
+    restoreLimits(knobMinFd, knobFd, knobMin, &savedKnobMin, &savedKnob);
+  } else if (savedKnob.Length > 0 && knobFd >= 0) {
+    writeFreqString(knobFd, &savedKnob);
+  }
+
+  free(pSavedEpps);
+  pSavedEpps = NULL;
+  free(pSavedUncoreMaxs);
+  pSavedUncoreMaxs = NULL;
+  free(pSavedUncoreMins);
+  pSavedUncoreMins = NULL;
+  savedKnob.Length = 0;
+  savedKnobMin.Length = 0;
 }
 
 void closeFreqSetterFiles(void) {
   int nbCore = getCoreNumber();
   int i = 0;
 
+  restoreKnobs(nbCore);
+
   if (pMaxSetFiles) {
     for (i = 0; i < nbCore; i++) {
       if (pMaxSetFiles[i]) {
@@ -67,5 +517,26 @@ void closeFreqSetterFiles(void) {
     }
 
     free(pMaxSetFiles);
+    pMaxSetFiles = NULL;
   }
-}
\ No newline at end of file
+
+  closeFds(pMaxSetFds, nbCore);
+  pMaxSetFds = NULL;
+  closeFds(pUncoreMinFds, nbCore);
+  pUncoreMinFds = NULL;
+  free(pUncoreMinFreqs);
+  pUncoreMinFreqs = NULL;
+  if (knobFd >= 0) {
+    close(knobFd);
+    knobFd = -1;
+  }
+  if (knobMinFd >= 0) {
+    close(knobMinFd);
+    knobMinFd = -1;
+  }
+  invertBoost = false;
+
+  free(pFreqStrings);
+  pFreqStrings = NULL;
+  nbFreqStrings = 0;
+}
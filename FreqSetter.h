@@ -19,17 +19,90 @@
 #ifndef FREQSETTER_H
 #define FREQSETTER_H
 
+#include <stdbool.h>
+
+#ifndef FREQ_SETTER_FILE
+#define FREQ_SETTER_FILE "scaling_max_freq"
+#endif
+
+/*
+ * How the frequency requests are written to the setter files
+ */
+enum FreqSetterBackend {
+  // One pwrite of a preformatted string on a raw file descriptor
+  FREQ_SETTER_PWRITE,
+  // fprintf and fflush on a stdio stream
+  FREQ_SETTER_STDIO,
+  // No file is written, the request is passed to the simulation
+  FREQ_SETTER_SIMULATED,
+  // The uncore frequency of the die of the core is set by writing the frequency to both min_freq_khz and max_freq_khz
+  // of intel_uncore_frequency, with one pwrite each
+  FREQ_SETTER_UNCORE,
+  // The following backends write a knob of intel_pstate instead of a frequency, the "frequencies" of the measurement
+  // are the values of the knob and the frequency the core settles at is not known in advance.
+  // energy_performance_preference of each core, 0 (performance) to 255 (power), the values with a name are written as
+  // their name
+  FREQ_SETTER_EPP,
+  // Both min_perf_pct and max_perf_pct of intel_pstate, shared by all the cores
+  FREQ_SETTER_PERF_PCT,
+  // cpufreq/boost, or the inverse of intel_pstate/no_turbo if it does not exist, 0 or 1, shared by all the cores
+  FREQ_SETTER_BOOST,
+};
+
 /**
  * Open and prepare frequency operation
+ * \param fileName the file in the cpufreq directory of each core that the frequency is written to, not used by the
+ * uncore backend
+ * \param backend how the requests are written
+ * \param pFreqs the frequencies that will be requested, formatted in advance for the pwrite backend
+ * \param nbFreqs the number of frequencies in \a pFreqs
  * \return 0 is everything gone fine
  */
-char openFreqSetterFiles();
+char openFreqSetterFiles(const char* fileName, enum FreqSetterBackend backend, unsigned int const* pFreqs,
+                         unsigned int nbFreqs);
 
 /**
  * Close the opened file to change frequencies
  */
 void closeFreqSetterFiles(void);
 
+/**
+ * Get the backend given to openFreqSetterFiles
+ */
+enum FreqSetterBackend getFreqSetterBackend(void);
+
+/**
+ * Tell if a backend writes a knob instead of a frequency
+ */
+bool isKnobBackend(enum FreqSetterBackend backend);
+
+/**
+ * Tell if the knob of a backend is shared by all the cores
+ */
+bool isGlobalKnobBackend(enum FreqSetterBackend backend);
+
+/**
+ * Get the name of the knob written by the backend given to openFreqSetterFiles
+ * \return the name, NULL if the backend writes frequencies
+ */
+const char* getKnobName(void);
+
+/**
+ * Get the name of what the backend given to openFreqSetterFiles sets, the same for the backends that write the same
+ * core frequencies
+ * \return core, simulated, uncore, epp, perf-pct or boost
+ */
+const char* getFreqSetterTargetName(void);
+
+/**
+ * Parse a frequency or a knob value of a backend, energy_performance_preference also accepts the names of the values
+ * \param backend the backend the value is written with
+ * \param pText the text to parse
+ * \param pValue where the value is written
+ * \return 0 if the text is a valid value for the backend
+ */
+char parseKnobValue(enum FreqSetterBackend backend, const char* pText, unsigned int* pValue);
+
 /**
  * Set a new frequency for a specific core determined by \a coreID
  * \param coreID the id of the core to set
@@ -0,0 +1,192 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "IdleState.h"
+#include "LoadStep.h"
+#include "utils.h"
+
+/*
+ * The disable settings of the idle states of a core before selectIdleState
+ */
+struct SavedIdleStates {
+  unsigned int CoreID;
+  unsigned int NbStates;
+  int Disabled[NB_MAX_IDLE_STATES];
+};
+
+static struct SavedIdleStates* pSavedStates = NULL;
+static unsigned int nbSavedStates = 0;
+
+static void idleStateFilePath(char* pBuffer, unsigned int coreID, unsigned int state, const char* fileName) {
+  snprintf(pBuffer, BUFFER_PATH_SIZE, CPUIDLE_PATH_FORMAT, sysfsCpuRoot, coreID, state, fileName);
+}
+
+/* Read the disable setting of an idle state
+ * \return 0 or 1, -1 if the state does not exist */
+static int readDisabled(unsigned int coreID, unsigned int state) {
+  char filePathBuffer[BUFFER_PATH_SIZE] = {'\0'};
+  int disabled = -1;
+
+  idleStateFilePath(filePathBuffer, coreID, state, "disable");
+  FILE* pFile = fopen(filePathBuffer, "r");
+  if (pFile == NULL) {
+    return -1;
+  }
+  if (fscanf(pFile, "%d", &disabled) != 1) {
+    disabled = -1;
+  }
+  fclose(pFile);
+
+  return disabled;
+}
+
+static int writeDisabled(unsigned int coreID, unsigned int state, int disabled) {
+  char filePathBuffer[BUFFER_PATH_SIZE] = {'\0'};
+
+  idleStateFilePath(filePathBuffer, coreID, state, "disable");
+  FILE* pFile = fopen(filePathBuffer, "w");
+  if (pFile == NULL) {
+    fprintf(stderr, "Fail to open %s\n", filePathBuffer);
+    return -1;
+  }
+  int ret = fprintf(pFile, "%d\n", disabled) > 0 ? 0 : -1;
+  if (fclose(pFile) != 0) {
+    ret = -1;
+  }
+  if (ret != 0) {
+    fprintf(stderr, "Fail to write %s\n", filePathBuffer);
+  }
+
+  return ret;
+}
+
+int selectIdleState(unsigned int coreID, unsigned int state) {
+  struct SavedIdleStates saved = {.CoreID = coreID, .NbStates = 0};
+
+  while (saved.NbStates < NB_MAX_IDLE_STATES &&
+         (saved.Disabled[saved.NbStates] = readDisabled(coreID, saved.NbStates)) >= 0) {
+    saved.NbStates++;
+  }
+  if (state >= saved.NbStates) {
+    fprintf(stderr, "Core %u has no idle state %u\n", coreID, state);
+    return -1;
+  }
+
+  struct SavedIdleStates* pStates = realloc(pSavedStates, sizeof(struct SavedIdleStates) * (nbSavedStates + 1));
+  if (pStates == NULL) {
+    fprintf(stderr, "Fail to allocate memory for the idle states\n");
+    return -1;
+  }
+  pSavedStates = pStates;
+  pSavedStates[nbSavedStates++] = saved;
+
+  for (unsigned int i = 0; i < saved.NbStates; i++) {
+    if (writeDisabled(coreID, i, i != state) != 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+void restoreIdleStates(void) {
+  for (unsigned int c = 0; c < nbSavedStates; c++) {
+    for (unsigned int i = 0; i < pSavedStates[c].NbStates; i++) {
+      writeDisabled(pSavedStates[c].CoreID, i, pSavedStates[c].Disabled[i]);
+    }
+  }
+
+  free(pSavedStates);
+  pSavedStates = NULL;
+  nbSavedStates = 0;
+}
+
+void readIdleStateName(unsigned int coreID, unsigned int state, char* pBuffer, size_t size) {
+  char filePathBuffer[BUFFER_PATH_SIZE] = {'\0'};
+  char format[16];
+
+  snprintf(pBuffer, size, "state%u", state);
+  idleStateFilePath(filePathBuffer, coreID, state, "name");
+  FILE* pFile = fopen(filePathBuffer, "r");
+  if (pFile == NULL) {
+    return;
+  }
+  // The name is read up to the first white space, so it can be used in a file name
+  snprintf(format, sizeof(format), "%%%zus", size - 1);
+  if (fscanf(pFile, format, pBuffer) != 1) {
+    snprintf(pBuffer, size, "state%u", state);
+  }
+  fclose(pFile);
+}
+
+int openIdleStateUsage(unsigned int coreID, unsigned int state) {
+  char filePathBuffer[BUFFER_PATH_SIZE] = {'\0'};
+
+  idleStateFilePath(filePathBuffer, coreID, state, "usage");
+  int fd = open(filePathBuffer, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Fail to open %s\n", filePathBuffer);
+  }
+
+  return fd;
+}
+
+unsigned long readIdleStateUsage(int fd) {
+  char buffer[32] = {'\0'};
+
+  if (pread(fd, buffer, sizeof(buffer) - 1, 0) <= 0) {
+    return 0;
+  }
+
+  return strtoul(buffer, NULL, 10);
+}
+
+int runIdleExit(struct MeasurementContext* ctx, unsigned int idleState, unsigned int freq, const char* outputDir) {
+  struct ConfidenceInterval Interval;
+  struct PairResults results;
+  char stateName[RESULT_IDLE_STATE_NAME_SIZE];
+
+  readIdleStateName(ctx->CoreID, idleState, stateName, sizeof(stateName));
+  int usageFd = openIdleStateUsage(ctx->CoreID, idleState);
+  if (usageFd >= 0) {
+    fprintf(stderr, "Core %u: calibrating %u with %s\n", ctx->CoreID, freq, ctx->pLoopKernel->Name);
+    calibrate(ctx, freq, &Interval);
+  }
+
+  // The other cores wait here even if this one can not measure
+  synchronize(ctx);
+  if (usageFd < 0) {
+    return -1;
+  }
+
+  initPairResults(ctx, freq, freq, &Interval, &Interval, &results);
+  results.Detector = DETECTOR_INTERVAL;
+  results.Mode = RESULT_MODE_IDLE_EXIT;
+  results.pIdleStateName = stateName;
+
+  fprintf(stderr, "Core %u: running exits from %s at %u\n", ctx->CoreID, stateName, freq);
+  measureWakeUps(ctx, NULL, &Interval, usageFd, &results);
+  close(usageFd);
+
+  return writeResults(outputDir, measurementConfig.Format, &results);
+}
@@ -0,0 +1,81 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDLESTATE_H
+#define IDLESTATE_H
+
+#include <stddef.h>
+
+#include "Measurement.h"
+
+#define CPUIDLE_PATH_FORMAT "%s/cpu%u/cpuidle/state%u/%s"
+// Number of idle states of a core that are looked at
+#define NB_MAX_IDLE_STATES 16
+
+/**
+ * Disable every cpuidle state of a core except one, so that the core can only sleep in it. The previous settings are
+ * kept until restoreIdleStates.
+ * \param coreID the core
+ * \param state the index of the idle state that stays enabled
+ * \return 0 if everything gone fine
+ */
+int selectIdleState(unsigned int coreID, unsigned int state);
+
+/**
+ * Restore the settings of all the idle states changed by selectIdleState
+ */
+void restoreIdleStates(void);
+
+/**
+ * Read the name of an idle state, e.g. C6
+ * \param pBuffer the buffer the name is written to, "state<index>" if the name can not be read
+ * \param size the size of the buffer
+ */
+void readIdleStateName(unsigned int coreID, unsigned int state, char* pBuffer, size_t size);
+
+/**
+ * Open the counter of the times the core entered an idle state
+ * \return the file descriptor, -1 on failure
+ */
+int openIdleStateUsage(unsigned int coreID, unsigned int state);
+
+/**
+ * Read the counter of the times the core entered an idle state
+ * \param fd the file descriptor returned by openIdleStateUsage
+ * \return the counter, 0 if it can not be read
+ */
+unsigned long readIdleStateUsage(int fd);
+
+/**
+ * Measure how long the core takes to leave an idle state and to run at a fixed frequency again.
+ * freq is calibrated and set with the frequency setter, the caller keeps only the idle state idleState enabled with
+ * selectIdleState. Each repetition sleeps for the wait time and runs the loop from the end of the sleep until its
+ * timing is inside the interquartile range of freq. Repetitions in which the usage counter of the idle state did not
+ * increase are discarded.
+ * The results have the columns of runTest, the end of the sleep takes the place of the frequency request: the write
+ * cost is the time to the first instruction after the wake-up, the change time with write the time to the target
+ * frequency and the estimated change time the start of the first loop at freq.
+ * \param ctx the measurement context of the calling thread
+ * \param idleState the index of the cpuidle state the core sleeps in
+ * \param freq the frequency the core runs at before and after the sleep
+ * \param outputDir the directory where the results are written, stdout if NULL
+ * \return 0 if everything gone fine
+ */
+int runIdleExit(struct MeasurementContext* ctx, unsigned int idleState, unsigned int freq, const char* outputDir);
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <time.h>
+
+#include "FreqGetter.h"
+#include "FreqSetter.h"
+#include "IdleState.h"
+#include "LoadStep.h"
+
+#include "loop.h"
+#include "rdtsc.h"
+
+/*
+ * Sleep waitTimeUs with an absolute deadline
+ * \return the TSC at the deadline, estimated from the TSC when going to sleep
+ */
+static unsigned long sleepUntil(unsigned long waitTimeUs) {
+  struct timespec deadline;
+  unsigned long stepCycles = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  sync_rdtsc1(stepCycles);
+
+  stepCycles += waitTimeUs * getTscFrequency() / 1000000;
+  deadline.tv_sec += waitTimeUs / 1000000;
+  deadline.tv_nsec += (waitTimeUs % 1000000) * 1000;
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+  }
+
+  return stepCycles;
+}
+
+void measureWakeUps(struct MeasurementContext* ctx, struct ConfidenceInterval const* SleepInterval,
+                    struct ConfidenceInterval const* TargetInterval, int usageFd, struct PairResults* pResults) {
+  struct MeasurementResults* pOut = &ctx->Results;
+  unsigned long lastStepCycles = 0;
+  unsigned long lastDetectionCycles = 0;
+
+  measureLoop(ctx, 1);
+  warmup_cpuid();
+
+  for (unsigned int it = 0; it < measurementConfig.NbReportTimes; it++) {
+    unsigned long waitTimeUs = nextWaitTime();
+    unsigned long stepCycles = 0;
+    unsigned long wakeCycles = 0;
+    unsigned long endLoopCycles = 0;
+    unsigned long reactionCycles = 0;
+    unsigned long reactionLoop = 0;
+    unsigned long usage = usageFd >= 0 ? readIdleStateUsage(usageFd) : 0;
+    unsigned int niters = 0;
+    bool slept = true;
+    bool reached = false;
+
+    ctx->TraceIteration = it;
+
+    // The thread sleeps, the step is the end of the sleep
+    stepCycles = sleepUntil(waitTimeUs);
+    sync_rdtsc1(wakeCycles);
+    // The TSC of the deadline is an estimate, the wake-up can not be before it
+    if (wakeCycles < stepCycles) {
+      stepCycles = wakeCycles;
+    }
+
+    do {
+      unsigned long endTime = 0;
+      unsigned long time = timedLoop(ctx->pLoopKernel, &endTime);
+
+      if (ctx->pTracer != NULL) {
+        traceSample(ctx->pTracer, endTime, time, it, 0);
+      }
+      reached = time >= TargetInterval->Q1 && time <= TargetInterval->Q3;
+      if (SleepInterval != NULL) {
+        // The governor did not lower the frequency during the sleep if the first loop already runs at the target
+        if (niters == 0) {
+          slept = time > TargetInterval->Q3;
+        }
+        if (reactionCycles == 0 && time < SleepInterval->Q1) {
+          reactionCycles = endTime - time;
+          reactionLoop = time;
+        }
+      } else if (reached) {
+        reactionCycles = endTime - time;
+        reactionLoop = time;
+      }
+    } while (!reached && ++niters < NB_TRY_REPET_LOOP);
+    sync_rdtsc2(endLoopCycles);
+
+    // The repetition only counts if the core went through the idle state during the sleep
+    if (usageFd >= 0 && readIdleStateUsage(usageFd) <= usage) {
+      slept = false;
+    }
+
+    if (slept && reached && validateFrequency(ctx, TargetInterval)) {
+      pOut->pMeasurements[it] = endLoopCycles - stepCycles;
+      pOut->pMeasurementsLate[it] = endLoopCycles - wakeCycles;
+      pOut->pWriteCosts[it] = wakeCycles - stepCycles;
+      pOut->pWaitTimes[it] = waitTimeUs;
+      pOut->pLastFrequencyChangeRequestCycles[it] = stepCycles - lastStepCycles;
+      pOut->pLastFrequencyChangeCycles[it] = endLoopCycles - lastDetectionCycles;
+      pOut->pTimestamps[it] = endLoopCycles;
+      pOut->pChangeEstimates[it] = reactionCycles > stepCycles ? reactionCycles - stepCycles : 0;
+      pOut->pEstimateErrors[it] = reactionLoop;
+    } else {
+      pOut->pMeasurements[it] = 0;
+      pOut->pMeasurementsLate[it] = 0;
+      pOut->pWriteCosts[it] = 0;
+      pOut->pWaitTimes[it] = 0;
+      pOut->pLastFrequencyChangeRequestCycles[it] = 0;
+      pOut->pLastFrequencyChangeCycles[it] = 0;
+      pOut->pTimestamps[it] = 0;
+      pOut->pChangeEstimates[it] = 0;
+      pOut->pEstimateErrors[it] = 0;
+    }
+    pOut->pDetectionConfidences[it] = 0;
+    lastStepCycles = stepCycles;
+    lastDetectionCycles = endLoopCycles;
+
+    if (ctx->pTracer != NULL) {
+      flushTracer(ctx->pTracer);
+    }
+  }
+
+  pResults->NbRepetitions = measurementConfig.NbReportTimes;
+}
+
+int runLoadStep(struct MeasurementContext* ctx, unsigned int startFreq, unsigned int targetFreq,
+                const char* outputDir) {
+  struct ConfidenceInterval StartInterval;
+  struct ConfidenceInterval TargetInterval;
+  struct PairResults results;
+
+  fprintf(stderr, "Core %u: calibrating %u with %s\n", ctx->CoreID, targetFreq, ctx->pLoopKernel->Name);
+  calibrate(ctx, targetFreq, &TargetInterval);
+  fprintf(stderr, "Core %u: calibrating %u with %s\n", ctx->CoreID, startFreq, ctx->pLoopKernel->Name);
+  calibrate(ctx, startFreq, &StartInterval);
+
+  // From now on the governor chooses the frequency, up to the target
+  setFreq(ctx->CoreID, targetFreq);
+  synchronize(ctx);
+
+  initPairResults(ctx, startFreq, targetFreq, &StartInterval, &TargetInterval, &results);
+  // The load steps are only detected with the interval detector
+  results.Detector = DETECTOR_INTERVAL;
+  results.Mode = RESULT_MODE_LOAD_STEP;
+
+  if (!overlapSignificantly(&StartInterval, &TargetInterval) || differSignificantly(&StartInterval, &TargetInterval)) {
+    fprintf(stderr, "Core %u: running load steps to %u\n", ctx->CoreID, targetFreq);
+    measureWakeUps(ctx, &StartInterval, &TargetInterval, -1, &results);
+  }
+
+  return writeResults(outputDir, measurementConfig.Format, &results);
+}
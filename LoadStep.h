@@ -0,0 +1,59 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOADSTEP_H
+#define LOADSTEP_H
+
+#include "Measurement.h"
+
+/**
+ * Measure how long the cpufreq governor takes to raise the frequency after the core goes from idle to busy.
+ * startFreq and targetFreq are calibrated with the frequency setter, targetFreq is then written once as the limit of
+ * the governor, e.g. with the setter file scaling_max_freq under schedutil or ondemand. Each repetition sleeps for the
+ * wait time, so that the governor lowers the frequency, and runs the loop from the end of the sleep until its timing
+ * is inside the interquartile range of targetFreq. Nothing is written to sysfs during the repetitions.
+ * The results have the columns of runTest, the load step (end of the sleep) takes the place of the frequency request:
+ * the write cost is the wake-up latency of the thread and the estimated change time is the start of the first loop
+ * faster than the interquartile range of startFreq, the reaction of the governor.
+ * \param ctx the measurement context of the calling thread
+ * \param startFreq the frequency the governor is expected to choose while the core sleeps
+ * \param targetFreq the frequency the governor raises the core to, higher than startFreq
+ * \param outputDir the directory where the results are written, stdout if NULL
+ * \return 0 if everything gone fine
+ */
+int runLoadStep(struct MeasurementContext* ctx, unsigned int startFreq, unsigned int targetFreq,
+                const char* outputDir);
+
+/**
+ * Measure wake-ups with the loop timings calibrated beforehand: each repetition sleeps for the wait time and runs the
+ * loop from the end of the sleep until its timing is inside the interquartile range of TargetInterval.
+ * The columns are the ones of runTest with the end of the sleep in place of the frequency request: the write cost is
+ * the time to the first instruction after the wake-up and the estimated change time the start of the first loop
+ * faster than the interquartile range of SleepInterval, or of the first loop at the target without it.
+ * \param ctx the measurement context of the calling thread
+ * \param SleepInterval the loop timing the core is expected to run at after the sleep, the repetitions whose first
+ * loop already runs at the target are discarded; NULL if the frequency does not change
+ * \param TargetInterval the loop timing the core reaches
+ * \param usageFd the usage counter of the idle state the core must enter during the sleep (see openIdleStateUsage),
+ * the repetitions where it does not increase are discarded; -1 to keep all of them
+ * \param pResults initialized with initPairResults, the number of repetitions is set
+ */
+void measureWakeUps(struct MeasurementContext* ctx, struct ConfidenceInterval const* SleepInterval,
+                    struct ConfidenceInterval const* TargetInterval, int usageFd, struct PairResults* pResults);
+
+#endif
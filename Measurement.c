@@ -0,0 +1,940 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "CalibrationCache.h"
+#include "FreqGetter.h"
+#include "FreqSetter.h"
+#include "Measurement.h"
+
+#include "loop.h"
+#include "rdtsc.h"
+#include "utils.h"
+
+#define NB_BENCH_META_REPET 100000
+#define NB_CALIBRATION_CHUNK 5000
+#define NB_CALIBRATION_MAX_REPET 2000000
+// Relative distance to the requested frequency accepted by the counter detector, at most half of the distance between
+// the start and the target frequency
+#define COUNTER_DETECTOR_TOLERANCE 0.05
+// Number of consecutive loops the CUSUM detector needs at least, the log-likelihood ratio of one loop is clamped so
+// that a single outlier can not cross the threshold
+#ifndef CUSUM_MIN_LOOPS
+#define CUSUM_MIN_LOOPS 3
+#endif
+// Ratio of the interquartile range to the standard deviation of a normal distribution
+#define NORMAL_IQR_RATIO 1.349
+
+struct MeasurementConfig measurementConfig = {
+    .CalibrationTolerance = 0,
+    .NbReportTimes = NB_REPORT_TIMES,
+    .WaitUs = NB_WAIT_US,
+#ifdef NB_WAIT_RANDOM
+    .WaitRandom = true,
+#else
+    .WaitRandom = false,
+#endif
+    .Format = RESULT_FORMAT_TEXT,
+    .Detector = DETECTOR_INTERVAL,
+    .NbCalibrationHistograms = 2,
+    .AutoLoopKernel = false,
+    .RecordRamp = false,
+    .RampAfterUs = 0,
+};
+
+size_t contextArenaSize() {
+  return arenaSize(sizeof(struct MeasurementContext)) +
+         RESULT_NB_FIELDS * arenaSize(sizeof(unsigned long) * measurementConfig.NbReportTimes) +
+         arenaSize(sizeof(struct StreamingStats) * measurementConfig.NbCalibrationHistograms);
+}
+
+struct MeasurementContext* createContext(struct Arena* pArena, unsigned int coreID) {
+  struct MeasurementContext* ctx = arenaAlloc(pArena, sizeof(struct MeasurementContext));
+  if (ctx == NULL) {
+    return NULL;
+  }
+
+  size_t resultsSize = sizeof(unsigned long) * measurementConfig.NbReportTimes;
+  ctx->CoreID = coreID;
+  ctx->pLoopKernel = &loopKernel;
+  ctx->Cycles.Fd = -1;
+  ctx->RefCycles.Fd = -1;
+  ctx->pRamp = NULL;
+  ctx->Results.pMeasurements = arenaAlloc(pArena, resultsSize);
+  ctx->Results.pMeasurementsLate = arenaAlloc(pArena, resultsSize);
+  ctx->Results.pTimestamps = arenaAlloc(pArena, resultsSize);
+  ctx->Results.pWaitTimes = arenaAlloc(pArena, resultsSize);
+  ctx->Results.pLastFrequencyChangeRequestCycles = arenaAlloc(pArena, resultsSize);
+  ctx->Results.pLastFrequencyChangeCycles = arenaAlloc(pArena, resultsSize);
+  ctx->Results.pWriteCosts = arenaAlloc(pArena, resultsSize);
+  ctx->Results.pChangeEstimates = arenaAlloc(pArena, resultsSize);
+  ctx->Results.pEstimateErrors = arenaAlloc(pArena, resultsSize);
+  ctx->Results.pDetectionConfidences = arenaAlloc(pArena, resultsSize);
+  ctx->pHistograms = arenaAlloc(pArena, sizeof(struct StreamingStats) * measurementConfig.NbCalibrationHistograms);
+  ctx->NbHistograms = 0;
+
+  if (ctx->Results.pDetectionConfidences == NULL || ctx->pHistograms == NULL) {
+    return NULL;
+  }
+
+  return ctx;
+}
+
+void busyWait(unsigned long time_in_us) {
+  unsigned long long before_time, after_time;
+  before_time = getusec();
+  do {
+    after_time = getusec();
+  } while (after_time - before_time < time_in_us);
+}
+
+unsigned long nextWaitTime() {
+  if (measurementConfig.WaitRandom) {
+    return xorshf96() % measurementConfig.WaitUs;
+  }
+  return measurementConfig.WaitUs;
+}
+
+void synchronize(struct MeasurementContext* ctx) {
+  if (ctx->pBarrier != NULL) {
+    pthread_barrier_wait(ctx->pBarrier);
+  }
+}
+
+void measureLoop(struct MeasurementContext* ctx, unsigned int nbMetaRepet) {
+  unsigned long endTime = 0;
+
+  for (unsigned int i = 0; i < nbMetaRepet; i++) {
+    ctx->Times[i] = timedLoop(ctx->pLoopKernel, &endTime);
+    if (ctx->pTracer != NULL) {
+      traceSample(ctx->pTracer, endTime, ctx->Times[i], ctx->TraceIteration, 0);
+    }
+  }
+}
+
+/*
+ * Stream the loop timings into the calibration stats, no sample is kept
+ */
+static void measureLoopStreaming(struct MeasurementContext* ctx, unsigned int nbMetaRepet) {
+  unsigned long endTime = 0;
+
+  for (unsigned int i = 0; i < nbMetaRepet; i++) {
+    unsigned long time = timedLoop(ctx->pLoopKernel, &endTime);
+    addStreamingSample(&ctx->CalibrationStats, time);
+    if (ctx->pTracer != NULL) {
+      traceSample(ctx->pTracer, endTime, time, ctx->TraceIteration, 0);
+    }
+  }
+}
+
+void measureReference(struct MeasurementContext* ctx, struct ConfidenceInterval* Interval) {
+  resetStreamingStats(&ctx->CalibrationStats);
+
+  if (measurementConfig.CalibrationTolerance <= 0) {
+    measureLoopStreaming(ctx, NB_BENCH_META_REPET);
+    buildFromStreamingStats(&ctx->CalibrationStats, Interval);
+    return;
+  }
+
+  struct ConfidenceInterval PreviousInterval;
+
+  measureLoopStreaming(ctx, NB_CALIBRATION_CHUNK);
+  buildFromStreamingStats(&ctx->CalibrationStats, Interval);
+  do {
+    PreviousInterval = *Interval;
+    measureLoopStreaming(ctx, NB_CALIBRATION_CHUNK);
+    buildFromStreamingStats(&ctx->CalibrationStats, Interval);
+  } while (!converged(&PreviousInterval, Interval, measurementConfig.CalibrationTolerance) &&
+           ctx->CalibrationStats.NbSamples < NB_CALIBRATION_MAX_REPET);
+}
+
+bool validateFrequency(struct MeasurementContext* ctx, struct ConfidenceInterval const* Interval) {
+  struct ConfidenceInterval ValidationInterval;
+
+  measureLoop(ctx, NB_VALIDATION_REPET);
+  buildFromMeasurement(ctx->Times, NB_VALIDATION_REPET, &ValidationInterval);
+
+  return overlapSignificantlyQ1Q3(Interval, &ValidationInterval);
+}
+
+/*
+ * Open the counters of the counter detector for the calling thread
+ * \return 0 if everything gone fine
+ */
+static int openDetectorCounters(struct MeasurementContext* ctx) {
+  if (openPerfCounter(&ctx->Cycles, ctx->CoreID, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES) != 0) {
+    fprintf(stderr, "Fail to open the cycle counter of core %u\n", ctx->CoreID);
+    return -1;
+  }
+
+  // The reference cycles tick at the TSC frequency, the TSC itself is used where they are not available
+  if (openPerfCounter(&ctx->RefCycles, ctx->CoreID, PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES) != 0) {
+    fprintf(stderr, "Core %u: no reference cycle counter, using the TSC\n", ctx->CoreID);
+  }
+  ctx->RefFrequency = getTscFrequency() / 1000;
+
+  return 0;
+}
+
+static void closeDetectorCounters(struct MeasurementContext* ctx) {
+  closePerfCounter(&ctx->Cycles);
+  closePerfCounter(&ctx->RefCycles);
+}
+
+/*
+ * Run the loop and compute the frequency of the core during it from the counters
+ * \return the number of TSC cycles the loop took
+ */
+static inline unsigned long countedLoop(struct MeasurementContext* ctx, unsigned long* pEndTime, unsigned int* pFreq) {
+  uint64_t refCycles = ctx->RefCycles.Fd >= 0 ? readPerfCounter(&ctx->RefCycles) : 0;
+  uint64_t cycles = readPerfCounter(&ctx->Cycles);
+  unsigned long time = timedLoop(ctx->pLoopKernel, pEndTime);
+  cycles = readPerfCounter(&ctx->Cycles) - cycles;
+  refCycles = ctx->RefCycles.Fd >= 0 ? readPerfCounter(&ctx->RefCycles) - refCycles : time;
+
+  *pFreq = refCycles == 0 ? 0 : (double)cycles * ctx->RefFrequency / refCycles;
+  return time;
+}
+
+/*
+ * What the detection waits for: the loop timing inside the calibrated interquartile range, or the frequency computed
+ * from the counters close to the requested one
+ */
+struct DetectionTarget {
+  struct ConfidenceInterval const* Interval;
+  unsigned int Freq;
+  unsigned int Tolerance;
+  // Normal models of the loop timings at the target and at the other frequency for the CUSUM detector, their scales
+  // are estimated from the interquartile ranges so the outliers of the calibration do not widen them
+  double Average;
+  double Scale;
+  double OtherAverage;
+  double OtherScale;
+};
+
+/* Standard deviation of a normal distribution with the interquartile range of the interval, at least one cycle */
+static double robustScale(struct ConfidenceInterval const* Interval) {
+  return fmax((Interval->Q3 - Interval->Q1) / NORMAL_IQR_RATIO, 1);
+}
+
+static struct DetectionTarget detectionTarget(struct ConfidenceInterval const* Interval,
+                                              struct ConfidenceInterval const* OtherInterval, unsigned int freq,
+                                              unsigned int otherFreq) {
+  unsigned int distance = freq > otherFreq ? freq - otherFreq : otherFreq - freq;
+  unsigned int tolerance = freq * COUNTER_DETECTOR_TOLERANCE;
+  struct DetectionTarget Target = {
+      .Interval = Interval,
+      .Freq = freq,
+      .Tolerance = tolerance < distance / 2 ? tolerance : distance / 2,
+  };
+
+  if (measurementConfig.Detector == DETECTOR_CUSUM) {
+    Target.Average = Interval->Average;
+    Target.Scale = robustScale(Interval);
+    Target.OtherAverage = OtherInterval->Average;
+    Target.OtherScale = robustScale(OtherInterval);
+  }
+
+  return Target;
+}
+
+/*
+ * State of the CUSUM detector during one detection
+ */
+struct Cusum {
+  // Log-likelihood ratio the sum has to reach, and the bound of the ratio of one loop
+  double Threshold;
+  double MaxRatio;
+  double Sum;
+  // Start of the first loop of the current run of positive sums, the estimated change time
+  unsigned long RunStart;
+  // The change happened at most one loop before or after RunStart
+  unsigned long RunStartError;
+  unsigned long PreviousTime;
+};
+
+/*
+ * Start a detection. The threshold is the log of the odds of the confidence level: a sum at the threshold means the
+ * target is that likely against the other frequency, with equal priors.
+ */
+static void resetCusum(struct Cusum* pCusum) {
+  double level = getConfidenceLevel();
+
+  pCusum->Threshold = log(level / (1 - level));
+  // CUSUM_MIN_LOOPS loops at the bound cross the threshold, one less does not
+  pCusum->MaxRatio = pCusum->Threshold / (CUSUM_MIN_LOOPS - 0.5);
+  pCusum->Sum = 0;
+  pCusum->RunStart = 0;
+  pCusum->RunStartError = 0;
+  pCusum->PreviousTime = 0;
+}
+
+/*
+ * Add the log-likelihood ratio of a loop timing between the target and the other frequency to the sum
+ * \return true if the sum crossed the threshold
+ */
+static inline bool updateCusum(struct Cusum* pCusum, struct DetectionTarget const* pTarget, unsigned long endTime,
+                               unsigned long time) {
+  double target = (time - pTarget->Average) / pTarget->Scale;
+  double other = (time - pTarget->OtherAverage) / pTarget->OtherScale;
+  double ratio = 0.5 * (other * other - target * target) + log(pTarget->OtherScale / pTarget->Scale);
+
+  ratio = fmin(fmax(ratio, -pCusum->MaxRatio), pCusum->MaxRatio);
+  if (pCusum->Sum <= 0 && ratio > 0) {
+    pCusum->RunStart = endTime - time;
+    pCusum->RunStartError = time > pCusum->PreviousTime ? time : pCusum->PreviousTime;
+  }
+  pCusum->Sum = fmax(pCusum->Sum + ratio, 0);
+  pCusum->PreviousTime = time;
+
+  return pCusum->Sum >= pCusum->Threshold;
+}
+
+/*
+ * Probability of the target against the other frequency at the end of a detection [per mille]
+ */
+static inline unsigned long cusumConfidence(struct Cusum const* pCusum) {
+  return 1000 / (1 + exp(-pCusum->Sum));
+}
+
+static inline bool closeToFreq(unsigned int freq, struct DetectionTarget const* pTarget) {
+  return freq + pTarget->Tolerance >= pTarget->Freq && freq <= pTarget->Freq + pTarget->Tolerance;
+}
+
+/*
+ * Run the loop once
+ * \param detector how the target is detected
+ * \param pCusum the state of the CUSUM detector, only used by it and NULL for the other detectors
+ * \return true if the core runs at the target
+ */
+static inline bool loopAtTarget(struct MeasurementContext* ctx, enum Detector detector,
+                                struct DetectionTarget const* pTarget, struct Cusum* pCusum, uint32_t iteration) {
+  unsigned long endTime = 0;
+  unsigned long time = 0;
+  unsigned int freq = 0;
+  bool reached;
+
+  if (detector == DETECTOR_COUNTERS) {
+    time = countedLoop(ctx, &endTime, &freq);
+    reached = closeToFreq(freq, pTarget);
+  } else if (detector == DETECTOR_CUSUM) {
+    assert(pCusum != NULL);
+    time = timedLoop(ctx->pLoopKernel, &endTime);
+    reached = updateCusum(pCusum, pTarget, endTime, time);
+  } else {
+    time = timedLoop(ctx->pLoopKernel, &endTime);
+    reached = time >= pTarget->Interval->Q1 && time <= pTarget->Interval->Q3;
+  }
+
+  if (ctx->pTracer != NULL) {
+    traceSample(ctx->pTracer, endTime, time, iteration, freq);
+  }
+  if (ctx->pRamp != NULL) {
+    rampSample(ctx->pRamp, endTime, time);
+  }
+
+  return reached;
+}
+
+/*
+ * Keep running the loop into the ramp until AfterCycles after the detection, or until the ramp is full
+ */
+static void recordRampTail(struct MeasurementContext* ctx, unsigned long detectionTime, uint32_t iteration) {
+  struct Ramp* pRamp = ctx->pRamp;
+  unsigned long endTime = detectionTime;
+
+  while (endTime - detectionTime < pRamp->AfterCycles && pRamp->pRepetition->NbRecords < RAMP_RECORDS) {
+    unsigned long time = timedLoop(ctx->pLoopKernel, &endTime);
+
+    if (ctx->pTracer != NULL) {
+      traceSample(ctx->pTracer, endTime, time, iteration, 0);
+    }
+    rampSample(pRamp, endTime, time);
+  }
+}
+
+/*
+ * Validate that the core stays at the target for NB_VALIDATION_REPET loops
+ */
+static bool validateTarget(struct MeasurementContext* ctx, enum Detector detector,
+                           struct DetectionTarget const* pTarget) {
+  if (detector != DETECTOR_COUNTERS) {
+    return validateFrequency(ctx, pTarget->Interval);
+  }
+
+  unsigned int nbAtTarget = 0;
+  for (unsigned int i = 0; i < NB_VALIDATION_REPET; i++) {
+    unsigned long endTime = 0;
+    unsigned int freq = 0;
+
+    ctx->Times[i] = countedLoop(ctx, &endTime, &freq);
+    if (ctx->pTracer != NULL) {
+      traceSample(ctx->pTracer, endTime, ctx->Times[i], ctx->TraceIteration, freq);
+    }
+    if (closeToFreq(freq, pTarget)) {
+      nbAtTarget++;
+    }
+  }
+
+  // Same criterion as the interval detector: at least the interquartile range is at the target
+  return nbAtTarget >= NB_VALIDATION_REPET / 2;
+}
+
+/*
+ * Keep a copy of the calibration histogram for the tests, the interval has none once all the copies are used
+ */
+static void keepHistogram(struct MeasurementContext* ctx, struct ConfidenceInterval* Interval) {
+  if (ctx->NbHistograms == measurementConfig.NbCalibrationHistograms) {
+    return;
+  }
+
+  struct StreamingStats* pHistogram = &ctx->pHistograms[ctx->NbHistograms++];
+  *pHistogram = ctx->CalibrationStats;
+  Interval->pHistogram = pHistogram;
+}
+
+void calibrate(struct MeasurementContext* ctx, unsigned int freq, struct ConfidenceInterval* Interval) {
+  setFreq(ctx->CoreID, freq);
+  waitCurFreq(ctx->CoreID, freq);
+  // Wait 10ms for settling of the frequency
+  busyWait(10000);
+
+  // Calibration samples do not belong to any repetition of the test
+  ctx->TraceIteration = TRACE_NO_ITERATION;
+
+  bool cached = false;
+  if (lookupCalibration(ctx->CoreID, ctx->pLoopKernel->Name, freq, Interval)) {
+    struct ConfidenceInterval CheckInterval;
+
+    // The bounds are rebuilt in case the cache was written with an other confidence level
+    confidenceInterval(Interval->NbSamples, Interval->Average, Interval->StandardDeviation, &Interval->LowerBound,
+                       &Interval->UpperBound);
+
+    measureLoop(ctx, NB_VALIDATION_REPET);
+    buildFromMeasurement(ctx->Times, NB_VALIDATION_REPET, &CheckInterval);
+
+    cached = overlapSignificantlyQ1Q3(Interval, &CheckInterval);
+    if (!cached) {
+      fprintf(stderr, "Cached calibration of %u does not match, recalibrating\n", freq);
+    }
+  }
+
+  if (!cached) {
+    measureReference(ctx, Interval);
+    storeCalibration(ctx->CoreID, ctx->pLoopKernel->Name, freq, Interval);
+    keepHistogram(ctx, Interval);
+  }
+
+  if (ctx->pTracer != NULL) {
+    flushTracer(ctx->pTracer);
+  }
+}
+
+void initPairResults(struct MeasurementContext* ctx, unsigned int startFreq, unsigned int targetFreq,
+                     struct ConfidenceInterval const* StartInterval, struct ConfidenceInterval const* TargetInterval,
+                     struct PairResults* pResults) {
+  *pResults = (struct PairResults){
+      .CoreID = ctx->CoreID,
+      .StartFreq = startFreq,
+      .TargetFreq = targetFreq,
+      .Detector = measurementConfig.Detector,
+      .pLoopName = ctx->pLoopKernel->Name,
+      .pKnobName = getKnobName(),
+      .StartInterval = *StartInterval,
+      .TargetInterval = *TargetInterval,
+      .TscFrequency = getTscFrequency(),
+      .WaitUs = measurementConfig.WaitUs,
+      .WaitRandom = measurementConfig.WaitRandom,
+      .NbRepetitions = 0,
+      .pFields =
+          {
+              [RESULT_CHANGE_TIME_WITH_WRITE] = ctx->Results.pMeasurements,
+              [RESULT_CHANGE_TIME] = ctx->Results.pMeasurementsLate,
+              [RESULT_WRITE_COST] = ctx->Results.pWriteCosts,
+              [RESULT_WAIT_TIME] = ctx->Results.pWaitTimes,
+              [RESULT_SINCE_CHANGE_REQUEST] = ctx->Results.pLastFrequencyChangeRequestCycles,
+              [RESULT_SINCE_CHANGE] = ctx->Results.pLastFrequencyChangeCycles,
+              [RESULT_DETECTION_TIMESTAMP] = ctx->Results.pTimestamps,
+              [RESULT_ESTIMATED_CHANGE_TIME] = ctx->Results.pChangeEstimates,
+              [RESULT_ESTIMATE_ERROR] = ctx->Results.pEstimateErrors,
+              [RESULT_DETECTION_CONFIDENCE] = ctx->Results.pDetectionConfidences,
+          },
+  };
+}
+
+void runTest(struct MeasurementContext* ctx, unsigned int startFreq, unsigned int targetFreq,
+             struct ConfidenceInterval const* StartInterval, struct ConfidenceInterval const* TargetInterval,
+             struct PairResults* pResults) {
+  unsigned long lastFrequencyChangeRequestCycles = 0;
+  unsigned long lastFrequencyChangeCycles = 0;
+  struct DetectionTarget Start = detectionTarget(StartInterval, TargetInterval, startFreq, targetFreq);
+  struct DetectionTarget Target = detectionTarget(TargetInterval, StartInterval, targetFreq, startFreq);
+  struct Cusum Cusum;
+  enum Detector detector = measurementConfig.Detector;
+
+  initPairResults(ctx, startFreq, targetFreq, StartInterval, TargetInterval, pResults);
+
+  {
+    sync_rdtsc1(lastFrequencyChangeRequestCycles);
+    setFreq(ctx->CoreID, startFreq);
+    waitCurFreq(ctx->CoreID, startFreq);
+    sync_rdtsc2(lastFrequencyChangeCycles);
+    // Wait 10ms for settling of the frequency
+    busyWait(10000);
+  }
+
+  // The transition can not be detected if the confidence intervals overlap considerably, unless the tests tell the
+  // loop timings apart
+  if (detector != DETECTOR_COUNTERS && overlapSignificantly(StartInterval, TargetInterval) &&
+      !differSignificantly(StartInterval, TargetInterval)) {
+    return;
+  }
+
+  sync();
+  measureLoop(ctx, 1);
+  warmup_cpuid();
+
+  unsigned long* measurements = ctx->Results.pMeasurements;
+  unsigned long* measurements_late = ctx->Results.pMeasurementsLate;
+  unsigned long* measurements_timestamp = ctx->Results.pTimestamps;
+  unsigned long* measurements_waitTime = ctx->Results.pWaitTimes;
+  unsigned long* measurements_lastFrequencyChangeRequestCycles = ctx->Results.pLastFrequencyChangeRequestCycles;
+  unsigned long* measurements_lastFrequencyChangeCycles = ctx->Results.pLastFrequencyChangeCycles;
+
+  for (unsigned int it = 0; it < measurementConfig.NbReportTimes; it++) {
+    char validated = 0;
+    unsigned long waitTimeUs = 0;
+
+    ctx->TraceIteration = it;
+    waitTimeUs = nextWaitTime();
+
+    // Wait some time
+    busyWait(waitTimeUs);
+
+    // Switch frequency to target and wait for the core to run at the target
+    {
+      unsigned long startLoopCycles = 0;
+      unsigned long lateStartLoopCycles = 0;
+      unsigned long endLoopCycles = 0;
+      unsigned int niters = 0;
+
+      resetCusum(&Cusum);
+      if (ctx->pRamp != NULL) {
+        startRamp(ctx->pRamp, it);
+      }
+      sync_rdtsc1(startLoopCycles);
+      setFreq(ctx->CoreID, targetFreq);
+      sync_rdtsc1(lateStartLoopCycles);
+      while (!loopAtTarget(ctx, detector, &Target, &Cusum, it) && ++niters < NB_TRY_REPET_LOOP) {
+      }
+      sync_rdtsc2(endLoopCycles);
+      if (ctx->pRamp != NULL) {
+        // The samples are aligned to the request when the repetition is written
+        detectedRamp(ctx->pRamp, startLoopCycles, endLoopCycles);
+        recordRampTail(ctx, endLoopCycles, it);
+      }
+
+      // Validation
+      validated = 1;
+      measurements[it] = endLoopCycles - startLoopCycles;
+      measurements_late[it] = endLoopCycles - lateStartLoopCycles;
+      measurements_timestamp[it] = endLoopCycles;
+      measurements_waitTime[it] = waitTimeUs;
+      measurements_lastFrequencyChangeRequestCycles[it] = startLoopCycles - lastFrequencyChangeRequestCycles;
+      measurements_lastFrequencyChangeCycles[it] = endLoopCycles - lastFrequencyChangeCycles;
+      if (detector == DETECTOR_CUSUM && (niters >= NB_TRY_REPET_LOOP || Cusum.RunStart < startLoopCycles)) {
+        // The CUSUM did not cross its threshold, there is no run to estimate the change from
+        validated = 0;
+        ctx->Results.pChangeEstimates[it] = 0;
+        ctx->Results.pEstimateErrors[it] = 0;
+        ctx->Results.pDetectionConfidences[it] = 0;
+      } else if (detector == DETECTOR_CUSUM) {
+        ctx->Results.pChangeEstimates[it] = Cusum.RunStart - startLoopCycles;
+        ctx->Results.pEstimateErrors[it] = Cusum.RunStartError;
+        ctx->Results.pDetectionConfidences[it] = cusumConfidence(&Cusum);
+      } else {
+        ctx->Results.pChangeEstimates[it] = 0;
+        ctx->Results.pEstimateErrors[it] = 0;
+        ctx->Results.pDetectionConfidences[it] = 0;
+      }
+    }
+
+    // Validate the frequency switch
+    if (!validateTarget(ctx, detector, &Target)) {
+      validated = 0;
+    }
+    if (ctx->pRamp != NULL) {
+      writeRamp(ctx->pRamp, validated);
+    }
+
+    // Switch frequency to start and wait for the core to run at it
+    {
+      sync_rdtsc1(lastFrequencyChangeRequestCycles);
+      resetCusum(&Cusum);
+      setFreq(ctx->CoreID, startFreq);
+      while (!loopAtTarget(ctx, detector, &Start, &Cusum, it)) {
+      }
+      sync_rdtsc2(lastFrequencyChangeCycles);
+    }
+
+    // Validate the frequency switch
+    if (!validateTarget(ctx, detector, &Start)) {
+      validated = 0;
+    }
+
+    // Write the trace of this repetition before waiting for the next one
+    if (ctx->pTracer != NULL) {
+      flushTracer(ctx->pTracer);
+    }
+
+    if (validated == 0) {
+      measurements[it] = 0;
+      measurements_late[it] = 0;
+      measurements_timestamp[it] = 0;
+      measurements_waitTime[it] = 0;
+      measurements_lastFrequencyChangeRequestCycles[it] = 0;
+      measurements_lastFrequencyChangeCycles[it] = 0;
+      ctx->Results.pChangeEstimates[it] = 0;
+      ctx->Results.pEstimateErrors[it] = 0;
+      ctx->Results.pDetectionConfidences[it] = 0;
+    }
+  }
+
+  for (unsigned int i = 0; i < measurementConfig.NbReportTimes; i++) {
+    ctx->Results.pWriteCosts[i] = measurements[i] - measurements_late[i];
+  }
+  pResults->NbRepetitions = measurementConfig.NbReportTimes;
+}
+
+/*
+ * Run the loop of the context for some time without timing it
+ */
+static void loopFor(struct MeasurementContext* ctx, unsigned long time_in_us) {
+  unsigned long long before_time = getusec();
+  unsigned long endTime = 0;
+
+  do {
+    timedLoop(ctx->pLoopKernel, &endTime);
+  } while (getusec() - before_time < time_in_us);
+}
+
+void runLoopTransitionTest(struct MeasurementContext* ctx, unsigned int freq, struct LoopKernel const* pStartKernel,
+                           struct ConfidenceInterval const* StartInterval, struct LoopKernel const* pTargetKernel,
+                           struct ConfidenceInterval const* TargetInterval, struct PairResults* pResults) {
+  unsigned long lastLoopChangeCycles = 0;
+  unsigned long lastLoopDetectionCycles = 0;
+  struct DetectionTarget Start = detectionTarget(StartInterval, TargetInterval, freq, freq);
+  struct DetectionTarget Target = detectionTarget(TargetInterval, StartInterval, freq, freq);
+  unsigned int niters = 0;
+
+  ctx->pLoopKernel = pStartKernel;
+  initPairResults(ctx, freq, freq, StartInterval, TargetInterval, pResults);
+  // The loop timings are only told apart with the interval detector
+  pResults->Detector = DETECTOR_INTERVAL;
+  pResults->Mode = RESULT_MODE_LOOP_TRANSITION;
+  pResults->pTargetLoopName = pTargetKernel->Name;
+  pResults->NbRepetitions = measurementConfig.NbReportTimes;
+
+  // A start loop that does not reach its calibration here invalidates the first repetition through its validation
+  sync_rdtsc1(lastLoopChangeCycles);
+  while (!loopAtTarget(ctx, DETECTOR_INTERVAL, &Start, NULL, TRACE_NO_ITERATION) && ++niters < NB_TRY_REPET_LOOP) {
+  }
+  sync_rdtsc2(lastLoopDetectionCycles);
+
+  for (unsigned int it = 0; it < measurementConfig.NbReportTimes; it++) {
+    unsigned long waitTimeUs = nextWaitTime();
+    unsigned long startLoopCycles = 0;
+    unsigned long endLoopCycles = 0;
+    bool validated = true;
+
+    ctx->TraceIteration = it;
+
+    // Run the start loop long enough for the core to settle into its frequency license
+    loopFor(ctx, waitTimeUs);
+
+    // Switch to the target loop and wait for its timing to reach the calibrated one. There is no request to write, the
+    // change time with and without write are the same.
+    ctx->pLoopKernel = pTargetKernel;
+    niters = 0;
+    sync_rdtsc1(startLoopCycles);
+    while (!loopAtTarget(ctx, DETECTOR_INTERVAL, &Target, NULL, it) && ++niters < NB_TRY_REPET_LOOP) {
+    }
+    sync_rdtsc2(endLoopCycles);
+
+    ctx->Results.pMeasurements[it] = endLoopCycles - startLoopCycles;
+    ctx->Results.pMeasurementsLate[it] = endLoopCycles - startLoopCycles;
+    ctx->Results.pWriteCosts[it] = 0;
+    ctx->Results.pTimestamps[it] = endLoopCycles;
+    ctx->Results.pWaitTimes[it] = waitTimeUs;
+    ctx->Results.pLastFrequencyChangeRequestCycles[it] = startLoopCycles - lastLoopChangeCycles;
+    ctx->Results.pLastFrequencyChangeCycles[it] = endLoopCycles - lastLoopDetectionCycles;
+    ctx->Results.pChangeEstimates[it] = 0;
+    ctx->Results.pEstimateErrors[it] = 0;
+    ctx->Results.pDetectionConfidences[it] = 0;
+
+    validated = niters < NB_TRY_REPET_LOOP && validateTarget(ctx, DETECTOR_INTERVAL, &Target);
+
+    // Switch back to the start loop and wait for its timing to recover, e.g. the license hysteresis may keep it away
+    // from its calibration
+    ctx->pLoopKernel = pStartKernel;
+    niters = 0;
+    sync_rdtsc1(lastLoopChangeCycles);
+    while (!loopAtTarget(ctx, DETECTOR_INTERVAL, &Start, NULL, it) && ++niters < NB_TRY_REPET_LOOP) {
+    }
+    sync_rdtsc2(lastLoopDetectionCycles);
+
+    if (niters >= NB_TRY_REPET_LOOP || !validateTarget(ctx, DETECTOR_INTERVAL, &Start)) {
+      validated = false;
+    }
+
+    if (ctx->pTracer != NULL) {
+      flushTracer(ctx->pTracer);
+    }
+
+    if (!validated) {
+      ctx->Results.pMeasurements[it] = 0;
+      ctx->Results.pMeasurementsLate[it] = 0;
+      ctx->Results.pTimestamps[it] = 0;
+      ctx->Results.pWaitTimes[it] = 0;
+      ctx->Results.pLastFrequencyChangeRequestCycles[it] = 0;
+      ctx->Results.pLastFrequencyChangeCycles[it] = 0;
+    }
+  }
+}
+
+int runLicense(struct MeasurementContext* ctx, unsigned int freq, struct LoopKernel const* pSimdKernel,
+               const char* outputDir) {
+  struct LoopKernel const* pScalarKernel = ctx->pLoopKernel;
+  struct ConfidenceInterval ScalarInterval;
+  struct ConfidenceInterval SimdInterval;
+  struct PairResults results;
+
+  // The SIMD loop is calibrated first, the calibration of the scalar loop waits for the license to be released
+  fprintf(stderr, "Core %u: calibrating %u with %s\n", ctx->CoreID, freq, pSimdKernel->Name);
+  ctx->pLoopKernel = pSimdKernel;
+  calibrate(ctx, freq, &SimdInterval);
+  fprintf(stderr, "Core %u: calibrating %u with %s\n", ctx->CoreID, freq, pScalarKernel->Name);
+  ctx->pLoopKernel = pScalarKernel;
+  calibrate(ctx, freq, &ScalarInterval);
+
+  synchronize(ctx);
+
+  fprintf(stderr, "Core %u: running %s -> %s\n", ctx->CoreID, pScalarKernel->Name, pSimdKernel->Name);
+  runLoopTransitionTest(ctx, freq, pScalarKernel, &ScalarInterval, pSimdKernel, &SimdInterval, &results);
+  int ret = writeResults(outputDir, measurementConfig.Format, &results);
+
+  if (ret == 0) {
+    fprintf(stderr, "Core %u: running %s -> %s\n", ctx->CoreID, pSimdKernel->Name, pScalarKernel->Name);
+    runLoopTransitionTest(ctx, freq, pSimdKernel, &SimdInterval, pScalarKernel, &ScalarInterval, &results);
+    ret = writeResults(outputDir, measurementConfig.Format, &results);
+  }
+
+  ctx->pLoopKernel = pScalarKernel;
+
+  return ret;
+}
+
+/*
+ * The reference loop timings of the frequencies with one loop variant
+ */
+struct KernelCalibration {
+  struct LoopKernel const* pKernel;
+  struct ConfidenceInterval Intervals[NB_MAX_FREQS];
+};
+
+/*
+ * Check if the detection can tell two frequencies apart: the interquartile ranges are disjoint and the confidence
+ * intervals do not overlap considerably
+ */
+static bool separated(struct ConfidenceInterval const* Lhs, struct ConfidenceInterval const* Rhs) {
+  return (Lhs->Q3 < Rhs->Q1 || Rhs->Q3 < Lhs->Q1) && !overlapSignificantly(Lhs, Rhs);
+}
+
+static bool allSeparated(struct ConfidenceInterval const* Intervals, unsigned int nbFreqs) {
+  for (unsigned int i = 0; i < nbFreqs; i++) {
+    for (unsigned int j = i + 1; j < nbFreqs; j++) {
+      if (!separated(&Intervals[i], &Intervals[j])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void calibrateAll(struct MeasurementContext* ctx, unsigned int* pFreqs, unsigned int nbFreqs,
+                         struct ConfidenceInterval* Intervals) {
+  for (unsigned int i = 0; i < nbFreqs; i++) {
+    fprintf(stderr, "Core %u: calibrating %u with %s\n", ctx->CoreID, pFreqs[i], ctx->pLoopKernel->Name);
+    calibrate(ctx, pFreqs[i], &Intervals[i]);
+  }
+}
+
+/*
+ * Calibrate the frequencies, or open the counters if the counter detector is used. With AutoLoopKernel, the loop
+ * variants are calibrated from the shortest on until one tells all the frequencies apart.
+ * \param Calibrations filled with one calibration per calibrated variant
+ * \param pNbCalibrations the number of calibrated variants
+ * \return 0 if everything gone fine
+ */
+static int prepareDetection(struct MeasurementContext* ctx, unsigned int* pFreqs, unsigned int nbFreqs,
+                            struct KernelCalibration* Calibrations, unsigned int* pNbCalibrations) {
+  Calibrations[0].pKernel = ctx->pLoopKernel;
+  *pNbCalibrations = 1;
+
+  if (measurementConfig.Detector == DETECTOR_COUNTERS) {
+    return openDetectorCounters(ctx);
+  }
+
+  if (!measurementConfig.AutoLoopKernel) {
+    calibrateAll(ctx, pFreqs, nbFreqs, Calibrations[0].Intervals);
+    return 0;
+  }
+
+  for (unsigned int k = 0; k < NB_LOOP_KERNELS; k++) {
+    ctx->pLoopKernel = &loopKernels[k];
+    Calibrations[k].pKernel = ctx->pLoopKernel;
+    *pNbCalibrations = k + 1;
+
+    calibrateAll(ctx, pFreqs, nbFreqs, Calibrations[k].Intervals);
+    if (allSeparated(Calibrations[k].Intervals, nbFreqs)) {
+      break;
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * Select the shortest calibrated loop variant that tells the start and the target frequency apart, the longest one if
+ * none does
+ * \return the calibration of the selected variant
+ */
+static struct KernelCalibration const* selectCalibration(struct MeasurementContext* ctx,
+                                                         struct KernelCalibration const* Calibrations,
+                                                         unsigned int nbCalibrations, unsigned int start,
+                                                         unsigned int target) {
+  unsigned int k = 0;
+  while (k + 1 < nbCalibrations &&
+         !separated(&Calibrations[k].Intervals[start], &Calibrations[k].Intervals[target])) {
+    k++;
+  }
+
+  ctx->pLoopKernel = Calibrations[k].pKernel;
+  return &Calibrations[k];
+}
+
+/*
+ * Open the ramp file of a pair, outputDir/start_target-ramp.bin, if the ramps are recorded
+ * \return 0 if everything gone fine
+ */
+static int openPairRamp(struct MeasurementContext* ctx, unsigned int startFreq, unsigned int targetFreq,
+                        const char* outputDir) {
+  char fileName[PATH_MAX];
+  struct RampHeader header = {
+      .CoreID = ctx->CoreID,
+      .StartFreq = startFreq,
+      .TargetFreq = targetFreq,
+      .TscFrequency = getTscFrequency(),
+      .AfterUs = measurementConfig.RampAfterUs,
+  };
+
+  if (!measurementConfig.RecordRamp) {
+    return 0;
+  }
+
+  snprintf(fileName, PATH_MAX, "%s/%u_%u-ramp.bin", outputDir, startFreq, targetFreq);
+  ctx->pRamp = openRamp(fileName, &header);
+
+  return ctx->pRamp == NULL ? -1 : 0;
+}
+
+static void closePairRamp(struct MeasurementContext* ctx) {
+  closeRamp(ctx->pRamp);
+  ctx->pRamp = NULL;
+}
+
+int runSweep(struct MeasurementContext* ctx, unsigned int* pFreqs, unsigned int nbFreqs, const char* outputDir) {
+  struct KernelCalibration Calibrations[NB_LOOP_KERNELS] = {0};
+  unsigned int nbCalibrations = 0;
+  int ret = prepareDetection(ctx, pFreqs, nbFreqs, Calibrations, &nbCalibrations);
+
+  synchronize(ctx);
+
+  for (unsigned int start = 0; start < nbFreqs && ret == 0; start++) {
+    for (unsigned int target = 0; target < nbFreqs && ret == 0; target++) {
+      if (pFreqs[start] == pFreqs[target]) {
+        continue;
+      }
+
+      struct PairResults results;
+      struct KernelCalibration const* pCalibration =
+          selectCalibration(ctx, Calibrations, nbCalibrations, start, target);
+
+      fprintf(stderr, "Core %u: running %u -> %u with %s\n", ctx->CoreID, pFreqs[start], pFreqs[target],
+              ctx->pLoopKernel->Name);
+      ret = openPairRamp(ctx, pFreqs[start], pFreqs[target], outputDir);
+      if (ret != 0) {
+        break;
+      }
+      runTest(ctx, pFreqs[start], pFreqs[target], &pCalibration->Intervals[start], &pCalibration->Intervals[target],
+              &results);
+      closePairRamp(ctx);
+
+      ret = writeResults(outputDir, measurementConfig.Format, &results);
+    }
+  }
+
+  closeDetectorCounters(ctx);
+
+  return ret;
+}
+
+int runPair(struct MeasurementContext* ctx, unsigned int startFreq, unsigned int targetFreq, const char* outputDir) {
+  // The target is calibrated first
+  unsigned int freqs[2] = {targetFreq, startFreq};
+  struct KernelCalibration Calibrations[NB_LOOP_KERNELS] = {0};
+  unsigned int nbCalibrations = 0;
+  int ret = prepareDetection(ctx, freqs, 2, Calibrations, &nbCalibrations);
+
+  synchronize(ctx);
+
+  if (ret == 0) {
+    ret = openPairRamp(ctx, startFreq, targetFreq, outputDir);
+  }
+
+  if (ret == 0) {
+    struct PairResults results;
+    struct KernelCalibration const* pCalibration = selectCalibration(ctx, Calibrations, nbCalibrations, 1, 0);
+
+    runTest(ctx, startFreq, targetFreq, &pCalibration->Intervals[1], &pCalibration->Intervals[0], &results);
+    closePairRamp(ctx);
+    ret = writeResults(outputDir, measurementConfig.Format, &results);
+  }
+
+  closeDetectorCounters(ctx);
+
+  return ret;
+}
@@ -0,0 +1,257 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MEASUREMENT_H
+#define MEASUREMENT_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "Arena.h"
+#include "ConfInterval.h"
+#include "PerfCounter.h"
+#include "Ramp.h"
+#include "ResultWriter.h"
+#include "StreamingStats.h"
+#include "Tracer.h"
+#include "loop.h"
+
+#define NB_VALIDATION_REPET 100
+#define NB_TRY_REPET_LOOP 1000000
+#define NB_MAX_FREQS 128
+
+// Defaults of the settings that can be changed on the command line
+#ifndef NB_REPORT_TIMES
+#define NB_REPORT_TIMES 10000
+#endif
+
+#ifndef NB_WAIT_US
+#define NB_WAIT_US 10000
+#endif
+
+/*
+ * Settings shared by the measurements on all cores
+ */
+struct MeasurementConfig {
+  // Relative tolerance for the adaptive calibration, 0 to calibrate with NB_BENCH_META_REPET loops
+  double CalibrationTolerance;
+  // The number of benchmark repetitions
+  unsigned int NbReportTimes;
+  // The time to wait between frequency switches
+  unsigned long WaitUs;
+  // Wait a random time between 0 and WaitUs instead
+  bool WaitRandom;
+  // The format the results of each pair are written in
+  enum ResultFormat Format;
+  // How the frequency change is detected
+  enum Detector Detector;
+  // Calibration histograms each context keeps for the Mann-Whitney U test, one per calibrated frequency and loop
+  unsigned int NbCalibrationHistograms;
+  // Calibrate the loop variants from the shortest on and measure each pair with the shortest one that tells its
+  // frequencies apart, instead of loopKernel
+  bool AutoLoopKernel;
+  // Record the loop samples of each frequency change into a ramp file per pair, until RampAfterUs after the detection
+  bool RecordRamp;
+  unsigned long RampAfterUs;
+};
+
+extern struct MeasurementConfig measurementConfig;
+
+/*
+ * Per repetition results of runTest, each array holds NbReportTimes values
+ */
+struct MeasurementResults {
+  unsigned long* pMeasurements;
+  unsigned long* pMeasurementsLate;
+  unsigned long* pTimestamps;
+  unsigned long* pWaitTimes;
+  unsigned long* pLastFrequencyChangeRequestCycles;
+  unsigned long* pLastFrequencyChangeCycles;
+  unsigned long* pWriteCosts;
+  // Only written by the CUSUM detector
+  unsigned long* pChangeEstimates;
+  unsigned long* pEstimateErrors;
+  unsigned long* pDetectionConfidences;
+};
+
+/*
+ * State of the measurement on one core. Each measuring thread owns one context.
+ */
+struct MeasurementContext {
+  unsigned int CoreID;
+  // The loop the calibration and the detection run
+  struct LoopKernel const* pLoopKernel;
+  // Barrier shared by all measuring threads, NULL if only one core is measured
+  pthread_barrier_t* pBarrier;
+  unsigned long Times[NB_VALIDATION_REPET];
+  struct StreamingStats CalibrationStats;
+  // Copies of CalibrationStats referenced by the calibrated intervals, NbCalibrationHistograms of them
+  struct StreamingStats* pHistograms;
+  unsigned int NbHistograms;
+  struct MeasurementResults Results;
+  // Sample tracer of this core, NULL if tracing is disabled
+  struct Tracer* pTracer;
+  // Ramp of the pair that is measured, NULL if the ramps are not recorded
+  struct Ramp* pRamp;
+  // The repetition the traced samples belong to
+  uint32_t TraceIteration;
+  // Counters of the counter detector, RefCycles is not opened (Fd -1) if the CPU has no reference cycle event,
+  // the TSC is used instead
+  struct PerfCounter Cycles;
+  struct PerfCounter RefCycles;
+  // Frequency of the reference cycles [kHz]
+  unsigned long RefFrequency;
+};
+
+/**
+ * The arena space needed by createContext, depends on the number of repetitions of the configuration
+ */
+size_t contextArenaSize();
+
+/**
+ * Allocate a measurement context and its result buffers from the arena
+ * \param pArena the arena to allocate from
+ * \param coreID the core that is measured with this context
+ * \return the context, NULL if the arena is too small
+ */
+struct MeasurementContext* createContext(struct Arena* pArena, unsigned int coreID);
+
+/**
+ * Busy wait, the core keeps running at its current frequency
+ * \param time_in_us the time to wait in us
+ */
+void busyWait(unsigned long time_in_us);
+
+/**
+ * Get the time to wait before the next frequency change
+ * \return a random time between 0 and WaitUs if WaitRandom is set, WaitUs otherwise
+ */
+unsigned long nextWaitTime();
+
+/**
+ * Wait for the measurements on all the other cores to reach the same point
+ * \param ctx the measurement context of the calling thread
+ */
+void synchronize(struct MeasurementContext* ctx);
+
+/**
+ * Run the loop and keep its timings in ctx->Times
+ * \param ctx the measurement context of the calling thread
+ * \param nbMetaRepet the number of loop executions, at most NB_VALIDATION_REPET
+ */
+void measureLoop(struct MeasurementContext* ctx, unsigned int nbMetaRepet);
+
+/**
+ * Build the reference loop timing of the current frequency.
+ * With a calibration tolerance, loops are measured in chunks of NB_CALIBRATION_CHUNK until the interval changes by
+ * less than the tolerance between two chunks.
+ * \param ctx the measurement context of the calling thread
+ * \param Interval where the reference loop timing is stored
+ */
+void measureReference(struct MeasurementContext* ctx, struct ConfidenceInterval* Interval);
+
+/**
+ * Check that the core runs at the frequency of the reference loop timing
+ * \param ctx the measurement context of the calling thread
+ * \param Interval the reference loop timing
+ * \return true if NB_VALIDATION_REPET loop timings overlap significantly with the reference
+ */
+bool validateFrequency(struct MeasurementContext* ctx, struct ConfidenceInterval const* Interval);
+
+/**
+ * Set the frequency of the core and build the reference loop timing for it.
+ * A cached calibration is used if a short check run agrees with it, it has no histogram.
+ * \param ctx the measurement context of the calling thread
+ * \param freq the frequency to calibrate
+ * \param Interval where the reference loop timing is stored
+ */
+void calibrate(struct MeasurementContext* ctx, unsigned int freq, struct ConfidenceInterval* Interval);
+
+/**
+ * Point the results of a pair to the context results and fill in the calibration and the configuration of the run,
+ * the detector and loop name are the ones of the configuration and of the context
+ * \param ctx the measurement context of the calling thread
+ * \param pResults the results to initialize, with no repetition
+ */
+void initPairResults(struct MeasurementContext* ctx, unsigned int startFreq, unsigned int targetFreq,
+                     struct ConfidenceInterval const* StartInterval, struct ConfidenceInterval const* TargetInterval,
+                     struct PairResults* pResults);
+
+/**
+ * Measure the transitions between startFreq and targetFreq with the loop timings calibrated beforehand
+ * \param ctx the measurement context of the calling thread
+ * \param startFreq the frequency at the beginning of each transition
+ * \param targetFreq the frequency to switch to
+ * \param StartInterval the reference loop timing at startFreq
+ * \param TargetInterval the reference loop timing at targetFreq
+ * \param pResults filled with the calibration and the fields of the context results
+ */
+void runTest(struct MeasurementContext* ctx, unsigned int startFreq, unsigned int targetFreq,
+             struct ConfidenceInterval const* StartInterval, struct ConfidenceInterval const* TargetInterval,
+             struct PairResults* pResults);
+
+/**
+ * Measure the transitions from one loop to an other at a fixed frequency, the loop timings are calibrated beforehand.
+ * A change of loop takes effect at once, what is measured is the time until the core runs the target loop at the
+ * calibrated speed, e.g. once it entered or left a SIMD frequency license.
+ * \param ctx the measurement context of the calling thread
+ * \param freq the requested frequency
+ * \param pStartKernel the loop run at the beginning of each transition
+ * \param StartInterval the reference timing of pStartKernel
+ * \param pTargetKernel the loop to switch to
+ * \param TargetInterval the reference timing of pTargetKernel
+ * \param pResults filled with the calibration and the fields of the context results
+ */
+void runLoopTransitionTest(struct MeasurementContext* ctx, unsigned int freq, struct LoopKernel const* pStartKernel,
+                           struct ConfidenceInterval const* StartInterval, struct LoopKernel const* pTargetKernel,
+                           struct ConfidenceInterval const* TargetInterval, struct PairResults* pResults);
+
+/**
+ * Calibrate the loop of the context and a SIMD loop at freq and measure the transitions from the loop of the context to
+ * the SIMD loop and back
+ * \param ctx the measurement context of the calling thread
+ * \param freq the requested frequency
+ * \param pSimdKernel the SIMD loop
+ * \param outputDir the directory where one result file per direction is written, stdout if NULL
+ * \return 0 if everything gone fine
+ */
+int runLicense(struct MeasurementContext* ctx, unsigned int freq, struct LoopKernel const* pSimdKernel,
+               const char* outputDir);
+
+/**
+ * Calibrate startFreq and targetFreq and measure the transitions between them
+ * \param ctx the measurement context of the calling thread
+ * \param startFreq the frequency at the beginning of each transition
+ * \param targetFreq the frequency to switch to
+ * \param outputDir the directory where the results are written, stdout if NULL
+ * \return 0 if everything gone fine
+ */
+int runPair(struct MeasurementContext* ctx, unsigned int startFreq, unsigned int targetFreq, const char* outputDir);
+
+/**
+ * Calibrate every frequency once and measure all the (start, target) pairs
+ * \param ctx the measurement context of the calling thread
+ * \param pFreqs the frequencies
+ * \param nbFreqs the number of frequencies
+ * \param outputDir the directory where one result file per pair is written, stdout if NULL
+ * \return 0 if everything gone fine
+ */
+int runSweep(struct MeasurementContext* ctx, unsigned int* pFreqs, unsigned int nbFreqs, const char* outputDir);
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "PerfCounter.h"
+
+char openPerfCounter(struct PerfCounter* pCounter, unsigned int coreID, uint32_t type, uint64_t config) {
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(struct perf_event_attr));
+  attr.size = sizeof(struct perf_event_attr);
+  attr.type = type;
+  attr.config = config;
+
+  pCounter->pPage = NULL;
+  pCounter->Fd = syscall(__NR_perf_event_open, &attr, 0, coreID, -1, 0);
+  if (pCounter->Fd < 0) {
+    perror("perf_event_open");
+    return -1;
+  }
+
+  // Without the page the counter is still usable with read()
+  void* pPage = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, pCounter->Fd, 0);
+  if (pPage != MAP_FAILED) {
+    pCounter->pPage = pPage;
+  }
+
+  return 0;
+}
+
+void closePerfCounter(struct PerfCounter* pCounter) {
+  if (pCounter->pPage != NULL) {
+    munmap(pCounter->pPage, sysconf(_SC_PAGESIZE));
+    pCounter->pPage = NULL;
+  }
+  if (pCounter->Fd >= 0) {
+    close(pCounter->Fd);
+    pCounter->Fd = -1;
+  }
+}
@@ -0,0 +1,104 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERFCOUNTER_H
+#define PERFCOUNTER_H
+
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <unistd.h>
+
+/*
+ * A hardware counter of the calling thread on one core. The counter is read in user space with rdpmc through the
+ * perf mmap page, or with read() if the kernel does not allow it.
+ */
+struct PerfCounter {
+  int Fd;
+  // The mmap page of the counter, NULL if it could not be mapped
+  struct perf_event_mmap_page* pPage;
+};
+
+/**
+ * Open a counter of the calling thread that counts while the thread runs on \a coreID
+ * \param pCounter the counter to set up
+ * \param coreID the core the calling thread is pinned to
+ * \param type the perf event type, e.g. PERF_TYPE_HARDWARE
+ * \param config the perf event, e.g. PERF_COUNT_HW_CPU_CYCLES
+ * \return 0 if everything gone fine
+ */
+char openPerfCounter(struct PerfCounter* pCounter, unsigned int coreID, uint32_t type, uint64_t config);
+
+/**
+ * Close a counter opened with openPerfCounter
+ */
+void closePerfCounter(struct PerfCounter* pCounter);
+
+/**
+ * Check if the counter is read with rdpmc
+ */
+static inline int perfCounterUsesRdpmc(struct PerfCounter const* pCounter) {
+  return pCounter->pPage != NULL && pCounter->pPage->cap_user_rdpmc;
+}
+
+static inline uint64_t readPerfCounterSyscall(struct PerfCounter const* pCounter) {
+  uint64_t value = 0;
+  if (read(pCounter->Fd, &value, sizeof(value)) != sizeof(value)) {
+    return 0;
+  }
+  return value;
+}
+
+/**
+ * Read the counter, without a system call if rdpmc is allowed
+ * \return the counter value, 0 on failure
+ */
+static inline uint64_t readPerfCounter(struct PerfCounter const* pCounter) {
+  struct perf_event_mmap_page volatile* pPage = pCounter->pPage;
+  uint32_t sequence;
+  uint64_t value;
+
+  if (pPage == NULL) {
+    return readPerfCounterSyscall(pCounter);
+  }
+
+  // The kernel updates the page under a sequence lock, retry if it changed during the read
+  do {
+    sequence = pPage->lock;
+    __asm__ volatile("" ::: "memory");
+
+    uint32_t index = pPage->index;
+    if (!pPage->cap_user_rdpmc || index == 0) {
+      // The counter is not active on the PMU
+      return readPerfCounterSyscall(pCounter);
+    }
+
+    uint32_t low, high;
+    __asm__ volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(index - 1));
+
+    // The PMU counter is only pmc_width bits wide and signed
+    unsigned int shift = 64 - pPage->pmc_width;
+    int64_t pmc = (int64_t)(((uint64_t)high << 32 | low) << shift) >> shift;
+    value = pPage->offset + pmc;
+
+    __asm__ volatile("" ::: "memory");
+  } while (pPage->lock != sequence);
+
+  return value;
+}
+
+#endif
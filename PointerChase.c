@@ -0,0 +1,108 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "PointerChase.h"
+#include "rdtsc.h"
+#include "utils.h"
+
+#define CACHE_LINE_SIZE 64
+
+/*
+ * Each cache line of the buffer holds the address of the next one
+ */
+struct ChaseLine {
+  struct ChaseLine* pNext;
+  char Padding[CACHE_LINE_SIZE - sizeof(struct ChaseLine*)];
+};
+
+static struct ChaseLine* pChaseBuffer = NULL;
+// Where the loop of each thread continues, every thread walks the same cycle
+static __thread struct ChaseLine* pChasePosition = NULL;
+
+static unsigned long chaseTimedLoop(unsigned long* pEndTime) {
+  struct ChaseLine* pLine = pChasePosition != NULL ? pChasePosition : pChaseBuffer;
+  unsigned long startTime = 0;
+  unsigned long endTime = 0;
+
+  sync_rdtsc1(startTime);
+  for (unsigned int i = 0; i < CHASE_LOADS; i++) {
+    pLine = pLine->pNext;
+  }
+  sync_rdtsc2(endTime);
+
+  pChasePosition = pLine;
+  *pEndTime = endTime;
+  return endTime - startTime;
+}
+
+const struct LoopKernel chaseLoopKernel = {
+    .Name = "chase_32",
+    .pTimedLoop = chaseTimedLoop,
+    .pOpen = openPointerChase,
+    .pClose = closePointerChase,
+};
+
+char openPointerChase(void) {
+  size_t nbLines = CHASE_BUFFER_SIZE / sizeof(struct ChaseLine);
+
+  if (pChaseBuffer != NULL) {
+    return 0;
+  }
+
+  // Populated up front, the page faults would otherwise be part of the first calibration
+  pChaseBuffer = mmap(NULL, CHASE_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1,
+                      0);
+  uint32_t* pOrder = malloc(sizeof(uint32_t) * nbLines);
+  if (pChaseBuffer == MAP_FAILED || pOrder == NULL) {
+    fprintf(stderr, "Fail to allocate memory for the chased buffer\n");
+    pChaseBuffer = pChaseBuffer == MAP_FAILED ? NULL : pChaseBuffer;
+    closePointerChase();
+    free(pOrder);
+    return -1;
+  }
+
+  // Sattolo's shuffle gives a random permutation made of a single cycle
+  for (size_t i = 0; i < nbLines; i++) {
+    pOrder[i] = i;
+  }
+  for (size_t i = nbLines - 1; i > 0; i--) {
+    size_t j = xorshf96() % i;
+    uint32_t swap = pOrder[i];
+    pOrder[i] = pOrder[j];
+    pOrder[j] = swap;
+  }
+  for (size_t i = 0; i < nbLines; i++) {
+    pChaseBuffer[pOrder[i]].pNext = &pChaseBuffer[pOrder[(i + 1) % nbLines]];
+  }
+
+  free(pOrder);
+
+  return 0;
+}
+
+void closePointerChase(void) {
+  if (pChaseBuffer != NULL) {
+    munmap(pChaseBuffer, CHASE_BUFFER_SIZE);
+    pChaseBuffer = NULL;
+  }
+}
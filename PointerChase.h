@@ -16,34 +16,35 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#ifndef DUMPRESULTS_H
-#define DUMPRESULTS_H
+#ifndef POINTERCHASE_H
+#define POINTERCHASE_H
 
-/**
- * Open the dump system
- * Open the file where the output will be printed
- * Allocate memory for the buffer
- * \param pFilename the filename where to write datas
- * \param bufferSize the maximal size of the buffer
- */
-void openDump(const char* pFileName, unsigned int bufferSize);
+#include "loop.h"
 
-/**
- * Write the time in the dump system
- * Technically, the time is just stored in the buffer
- * When the buffer is full, all the data stored will be printed in the file
- * \param time the time to store
+// Size of the chased buffer, much larger than the last level cache so that every load goes to memory
+#ifndef CHASE_BUFFER_SIZE
+#define CHASE_BUFFER_SIZE (256UL << 20)
+#endif
+
+// Dependent loads of one loop
+#define CHASE_LOADS 32
+
+/*
+ * The memory bound loop chase_32: 32 dependent loads that each miss the last level cache. Its timing follows the
+ * uncore and memory frequency rather than the core frequency.
  */
-void writeDump(unsigned long time);
+extern const struct LoopKernel chaseLoopKernel;
 
 /**
- * Reset the dump be removing all elements in the buffer and rewinding the file
+ * Allocate the buffer and link its cache lines into a single cycle in random order, so that the prefetchers can not
+ * guess the next line
+ * \return 0 if everything gone fine
  */
-void resetDump();
+char openPointerChase(void);
 
 /**
- * Closes and free the dump system
+ * Free the buffer
  */
-void closeDump();
+void closePointerChase(void);
 
 #endif
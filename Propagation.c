@@ -0,0 +1,223 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "FreqGetter.h"
+#include "FreqSetter.h"
+#include "Measurement.h"
+#include "Propagation.h"
+
+#include "loop.h"
+#include "rdtsc.h"
+#include "utils.h"
+
+/*
+ * State shared by the controller and the observers
+ */
+struct PropagationState {
+  // Synchronizes the controller and all observers
+  pthread_barrier_t Barrier;
+  // Incremented by the controller after each frequency request
+  unsigned int Generation;
+  // Timestamp taken just before the last frequency request
+  unsigned long RequestCycles;
+};
+
+struct Observer {
+  pthread_t Thread;
+  struct MeasurementContext* pContext;
+  struct PropagationState* pState;
+  struct ConfidenceInterval StartInterval;
+  struct ConfidenceInterval TargetInterval;
+  // False if the loop timings of the observer do not tell the two frequencies apart
+  bool Affected;
+  unsigned long* pLatencies;
+};
+
+/*
+ * Run the loop until its timing is inside the interquartile band and the request of the given generation was made
+ * \return the timestamp of the detection, 0 if the loop timing did not reach the band
+ */
+static unsigned long detectChange(struct PropagationState* pState, unsigned int generation,
+                                  struct ConfidenceInterval const* Interval) {
+  unsigned long endLoopCycles = 0;
+  unsigned int niters = 0;
+  unsigned long time = 0;
+  bool inBand = false;
+
+  do {
+    time = loop();
+    inBand = time >= Interval->Q1 && time <= Interval->Q3;
+  } while (!(inBand && __atomic_load_n(&pState->Generation, __ATOMIC_ACQUIRE) == generation) &&
+           ++niters < NB_TRY_REPET_LOOP);
+  sync_rdtsc2(endLoopCycles);
+
+  return niters < NB_TRY_REPET_LOOP ? endLoopCycles : 0;
+}
+
+static void* observe(void* pArg) {
+  struct Observer* pObserver = pArg;
+  struct MeasurementContext* ctx = pObserver->pContext;
+  struct PropagationState* pState = pObserver->pState;
+
+  pinCPU(ctx->CoreID);
+
+  // The controller sets the target frequency, then the start frequency
+  pthread_barrier_wait(&pState->Barrier);
+  measureReference(ctx, &pObserver->TargetInterval);
+  pthread_barrier_wait(&pState->Barrier);
+  pthread_barrier_wait(&pState->Barrier);
+  measureReference(ctx, &pObserver->StartInterval);
+  pthread_barrier_wait(&pState->Barrier);
+
+  pObserver->Affected = !overlapSignificantly(&pObserver->StartInterval, &pObserver->TargetInterval) ||
+                        differSignificantly(&pObserver->StartInterval, &pObserver->TargetInterval);
+
+  loop();
+  warmup_cpuid();
+
+  for (unsigned int it = 0; it < measurementConfig.NbReportTimes; it++) {
+    unsigned long latency = 0;
+
+    if (pObserver->Affected) {
+      unsigned long endLoopCycles = detectChange(pState, 2 * it + 1, &pObserver->TargetInterval);
+      if (endLoopCycles != 0 && validateFrequency(ctx, &pObserver->TargetInterval)) {
+        latency = endLoopCycles - pState->RequestCycles;
+      }
+    }
+    pthread_barrier_wait(&pState->Barrier);
+
+    if (pObserver->Affected) {
+      detectChange(pState, 2 * it + 2, &pObserver->StartInterval);
+      if (!validateFrequency(ctx, &pObserver->StartInterval)) {
+        latency = 0;
+      }
+    }
+    pthread_barrier_wait(&pState->Barrier);
+
+    pObserver->pLatencies[it] = latency;
+  }
+
+  return NULL;
+}
+
+/*
+ * Set a frequency on the controller core and publish the timestamp of the request to the observers
+ */
+static void request(struct PropagationState* pState, unsigned int generation, unsigned int coreID, unsigned int freq) {
+  unsigned long requestCycles = 0;
+
+  sync_rdtsc1(requestCycles);
+  setFreq(coreID, freq);
+  pState->RequestCycles = requestCycles;
+  __atomic_store_n(&pState->Generation, generation, __ATOMIC_RELEASE);
+}
+
+size_t propagationArenaSize(unsigned int nbObservers) {
+  size_t resultsSize = arenaSize(sizeof(unsigned long) * measurementConfig.NbReportTimes);
+
+  return arenaSize(sizeof(struct Observer) * nbObservers) + resultsSize +
+         nbObservers * (contextArenaSize() + resultsSize);
+}
+
+int runPropagation(struct Arena* pArena, FILE* out, unsigned int controllerCore, unsigned int* pObservers,
+                   unsigned int nbObservers, unsigned int startFreq, unsigned int targetFreq) {
+  struct PropagationState state = {.Generation = 0, .RequestCycles = 0};
+  size_t resultsSize = sizeof(unsigned long) * measurementConfig.NbReportTimes;
+  struct Observer* pObserverList = arenaAlloc(pArena, sizeof(struct Observer) * nbObservers);
+  unsigned long* pWaitTimes = arenaAlloc(pArena, resultsSize);
+
+  if (pObserverList == NULL || pWaitTimes == NULL) {
+    return -1;
+  }
+
+  for (unsigned int i = 0; i < nbObservers; i++) {
+    pObserverList[i].pState = &state;
+    pObserverList[i].pContext = createContext(pArena, pObservers[i]);
+    pObserverList[i].pLatencies = arenaAlloc(pArena, resultsSize);
+    if (pObserverList[i].pContext == NULL || pObserverList[i].pLatencies == NULL) {
+      return -1;
+    }
+  }
+
+  pinCPU(controllerCore);
+  pthread_barrier_init(&state.Barrier, NULL, nbObservers + 1);
+
+  for (unsigned int i = 0; i < nbObservers; i++) {
+    pthread_create(&pObserverList[i].Thread, NULL, observe, &pObserverList[i]);
+  }
+
+  // Calibration of the observers
+  setFreq(controllerCore, targetFreq);
+  waitCurFreq(controllerCore, targetFreq);
+  busyWait(10000);
+  pthread_barrier_wait(&state.Barrier);
+  pthread_barrier_wait(&state.Barrier);
+  setFreq(controllerCore, startFreq);
+  waitCurFreq(controllerCore, startFreq);
+  busyWait(10000);
+  pthread_barrier_wait(&state.Barrier);
+  pthread_barrier_wait(&state.Barrier);
+
+  for (unsigned int it = 0; it < measurementConfig.NbReportTimes; it++) {
+    pWaitTimes[it] = nextWaitTime();
+    busyWait(pWaitTimes[it]);
+
+    request(&state, 2 * it + 1, controllerCore, targetFreq);
+    pthread_barrier_wait(&state.Barrier);
+    request(&state, 2 * it + 2, controllerCore, startFreq);
+    pthread_barrier_wait(&state.Barrier);
+  }
+
+  for (unsigned int i = 0; i < nbObservers; i++) {
+    pthread_join(pObserverList[i].Thread, NULL);
+  }
+  pthread_barrier_destroy(&state.Barrier);
+
+  fprintf(out, "# TSC frequency %lu Hz\n", getTscFrequency());
+  fprintf(out, "# Frequency requests on core %u\n", controllerCore);
+  for (unsigned int i = 0; i < nbObservers; i++) {
+    fprintf(out, "# Observer core %u\n", pObservers[i]);
+    dump(out, &pObserverList[i].StartInterval, startFreq, "Start");
+    dump(out, &pObserverList[i].TargetInterval, targetFreq, "Target");
+    if (!pObserverList[i].Affected) {
+      fprintf(out, "# Warning: loop timings do not differ significantly, core %u does not follow the requests\n",
+              pObservers[i]);
+    }
+  }
+
+  fprintf(out, "Wait time [us]");
+  for (unsigned int i = 0; i < nbObservers; i++) {
+    fprintf(out, "\tChange time core %u [cycles]", pObservers[i]);
+  }
+  fprintf(out, "\n");
+  for (unsigned int it = 0; it < measurementConfig.NbReportTimes; it++) {
+    fprintf(out, "%lu", pWaitTimes[it]);
+    for (unsigned int i = 0; i < nbObservers; i++) {
+      fprintf(out, "\t%lu", pObserverList[i].pLatencies[it]);
+    }
+    fprintf(out, "\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROPAGATION_H
+#define PROPAGATION_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "Arena.h"
+
+/**
+ * The arena space needed by runPropagation
+ * \param nbObservers the number of observer cores
+ */
+size_t propagationArenaSize(unsigned int nbObservers);
+
+/**
+ * Measure how long a frequency request made on one core takes to affect other cores.
+ * The calling thread is pinned to controllerCore and writes the frequency requests of that core. One thread per
+ * observer core runs the loop and detects the frequency change. As the TSC is synchronized between cores, the latency
+ * of each observer is its detection timestamp minus the timestamp of the request.
+ * \param pArena the arena the measurement buffers are allocated from
+ * \param out the stream where the results are printed
+ * \param controllerCore the core whose frequency is requested
+ * \param pObservers the cores on which the change is detected
+ * \param nbObservers the number of observer cores
+ * \param startFreq the frequency at the beginning of each transition
+ * \param targetFreq the frequency to switch to
+ * \return 0 if everything gone fine
+ */
+int runPropagation(struct Arena* pArena, FILE* out, unsigned int controllerCore, unsigned int* pObservers,
+                   unsigned int nbObservers, unsigned int startFreq, unsigned int targetFreq);
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Ramp.h"
+#include "utils.h"
+
+struct Ramp* openRamp(const char* pFileName, struct RampHeader const* pHeader) {
+  struct RampHeader header = *pHeader;
+
+  memcpy(header.Magic, RAMP_MAGIC, sizeof(header.Magic));
+  header.Version = RAMP_VERSION;
+  header.RecordSize = sizeof(struct RampRecord);
+  header.RecordsPerRepetition = RAMP_RECORDS;
+  header.NbRepetitions = 0;
+
+  struct Ramp* pRamp = calloc(1, sizeof(struct Ramp));
+  if (pRamp == NULL) {
+    fprintf(stderr, "Fail to allocate memory for the ramp\n");
+    return NULL;
+  }
+  pRamp->AfterCycles = header.AfterUs * header.TscFrequency / 1000000;
+
+  // The buffer is faulted in now, so that recording never page faults
+  pRamp->pRepetition = mmap(NULL, sizeof(struct RampRepetition), PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (pRamp->pRepetition == MAP_FAILED) {
+    perror("mmap");
+    free(pRamp);
+    return NULL;
+  }
+  memset(pRamp->pRepetition, 0, sizeof(struct RampRepetition));
+
+  pRamp->Fd = open(pFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (pRamp->Fd < 0) {
+    fprintf(stderr, "Fail to open ramp file %s\n", pFileName);
+    munmap(pRamp->pRepetition, sizeof(struct RampRepetition));
+    free(pRamp);
+    return NULL;
+  }
+
+  writeAll(pRamp->Fd, &header, sizeof(header));
+
+  return pRamp;
+}
+
+void startRamp(struct Ramp* pRamp, uint32_t iteration) {
+  pRamp->pRepetition->Iteration = iteration;
+  pRamp->pRepetition->NbRecords = 0;
+  pRamp->pRepetition->NbDropped = 0;
+  pRamp->Recording = true;
+}
+
+void detectedRamp(struct Ramp* pRamp, uint64_t writeTsc, uint64_t detectionTsc) {
+  pRamp->WriteTsc = writeTsc;
+  pRamp->pRepetition->DetectionTime = detectionTsc - writeTsc;
+}
+
+void writeRamp(struct Ramp* pRamp, bool validated) {
+  struct RampRepetition* pRepetition = pRamp->pRepetition;
+
+  pRamp->Recording = false;
+  pRepetition->Validated = validated;
+  for (uint32_t i = 0; i < pRepetition->NbRecords; i++) {
+    pRepetition->Records[i].SinceWrite -= pRamp->WriteTsc;
+  }
+
+  writeAll(pRamp->Fd, pRepetition,
+           offsetof(struct RampRepetition, Records) + sizeof(struct RampRecord) * pRepetition->NbRecords);
+  pRamp->NbRepetitions++;
+}
+
+void closeRamp(struct Ramp* pRamp) {
+  if (pRamp == NULL) {
+    return;
+  }
+
+  if (pwrite(pRamp->Fd, &pRamp->NbRepetitions, sizeof(pRamp->NbRepetitions),
+             offsetof(struct RampHeader, NbRepetitions)) != sizeof(pRamp->NbRepetitions)) {
+    perror("pwrite");
+  }
+
+  close(pRamp->Fd);
+  munmap(pRamp->pRepetition, sizeof(struct RampRepetition));
+  free(pRamp);
+}
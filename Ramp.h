@@ -0,0 +1,142 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RAMP_H
+#define RAMP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Number of loop samples recorded per repetition, the later ones are dropped and counted
+#ifndef RAMP_RECORDS
+#define RAMP_RECORDS 8192
+#endif
+
+#define RAMP_MAGIC "FTALRMP"
+#define RAMP_VERSION 2
+
+/*
+ * Layout of a ramp file: this header followed by each repetition, the fields of struct RampRepetition before Records
+ * and then its NbRecords records, all in host byte order
+ */
+struct RampHeader {
+  char Magic[8];
+  uint32_t Version;
+  uint32_t RecordSize;
+  uint32_t CoreID;
+  uint32_t StartFreq;
+  uint32_t TargetFreq;
+  // The most records a repetition can hold
+  uint32_t RecordsPerRepetition;
+  // Updated when the ramp is closed
+  uint64_t NbRepetitions;
+  uint64_t TscFrequency;
+  // Time recorded after the detection [us]
+  uint64_t AfterUs;
+};
+
+struct RampRecord {
+  // TSC cycles from the frequency request to the end of the loop. Holds the TSC of the end of the loop until the
+  // repetition is written.
+  uint64_t SinceWrite;
+  uint32_t LoopCycles;
+  uint32_t Reserved;
+};
+
+/*
+ * The samples of one repetition, from the frequency request until AfterUs after the detection. Only the NbRecords
+ * recorded samples are written.
+ */
+struct RampRepetition {
+  uint32_t Iteration;
+  uint32_t NbRecords;
+  uint32_t NbDropped;
+  uint32_t Validated;
+  // TSC cycles from the frequency request to the detection
+  uint64_t DetectionTime;
+  struct RampRecord Records[RAMP_RECORDS];
+};
+
+/*
+ * Records the loop samples around the frequency change of each repetition into a pre-faulted buffer with plain
+ * stores. The buffer is written to the file once the repetition is validated.
+ */
+struct Ramp {
+  int Fd;
+  struct RampRepetition* pRepetition;
+  bool Recording;
+  // TSC right before the frequency request, TSC cycles recorded after the detection
+  uint64_t WriteTsc;
+  uint64_t AfterCycles;
+  uint64_t NbRepetitions;
+};
+
+/**
+ * Create a ramp and the file it writes to
+ * \param pFileName the ramp file
+ * \param pHeader the header of the file, NbRepetitions is set when the ramp is closed
+ * \return the ramp, NULL on failure
+ */
+struct Ramp* openRamp(const char* pFileName, struct RampHeader const* pHeader);
+
+/**
+ * Start recording a repetition, before the frequency request
+ * \param iteration the benchmark repetition
+ */
+void startRamp(struct Ramp* pRamp, uint32_t iteration);
+
+/**
+ * Set the times of the repetition once the frequency change is detected
+ * \param writeTsc the TSC right before the frequency request
+ * \param detectionTsc the TSC at the detection of the frequency change
+ */
+void detectedRamp(struct Ramp* pRamp, uint64_t writeTsc, uint64_t detectionTsc);
+
+/**
+ * Stop recording, align the samples to the frequency request and write the repetition to the file
+ * \param validated whether the frequency change was validated
+ */
+void writeRamp(struct Ramp* pRamp, bool validated);
+
+/**
+ * Complete the header and free the ramp
+ */
+void closeRamp(struct Ramp* pRamp);
+
+/**
+ * Record a loop sample if a repetition is recorded, no system call is made
+ * \param tsc the timestamp at the end of the loop
+ * \param loopCycles the number of TSC cycles the loop took
+ */
+static inline void rampSample(struct Ramp* pRamp, uint64_t tsc, uint32_t loopCycles) {
+  struct RampRepetition* pRepetition = pRamp->pRepetition;
+
+  if (!pRamp->Recording) {
+    return;
+  }
+  if (pRepetition->NbRecords == RAMP_RECORDS) {
+    pRepetition->NbDropped++;
+    return;
+  }
+
+  pRepetition->Records[pRepetition->NbRecords].SinceWrite = tsc;
+  pRepetition->Records[pRepetition->NbRecords].LoopCycles = loopCycles;
+  pRepetition->NbRecords++;
+}
+
+#endif
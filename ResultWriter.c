@@ -0,0 +1,350 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ResultWriter.h"
+#include "utils.h"
+
+_Static_assert(sizeof(unsigned long) == sizeof(uint64_t), "the fields are written without conversion");
+
+static void toResultInterval(struct ConfidenceInterval const* Interval, struct ResultInterval* pOut) {
+  pOut->NbSamples = Interval->NbSamples;
+  pOut->Average = Interval->Average;
+  pOut->StandardDeviation = Interval->StandardDeviation;
+  pOut->LowerBound = Interval->LowerBound;
+  pOut->UpperBound = Interval->UpperBound;
+  pOut->Q1 = Interval->Q1;
+  pOut->Q3 = Interval->Q3;
+}
+
+static void fromResultInterval(struct ResultInterval const* pIn, struct ConfidenceInterval* Interval) {
+  Interval->NbSamples = pIn->NbSamples;
+  Interval->Average = pIn->Average;
+  Interval->StandardDeviation = pIn->StandardDeviation;
+  Interval->LowerBound = pIn->LowerBound;
+  Interval->UpperBound = pIn->UpperBound;
+  Interval->Q1 = pIn->Q1;
+  Interval->Q3 = pIn->Q3;
+  Interval->pHistogram = NULL;
+}
+
+/*
+ * The column of a field in the text format
+ */
+struct FieldColumn {
+  const char* Name;
+  const char* Unit;
+  // The field is a duration in TSC cycles, it gets a microsecond column
+  bool Duration;
+};
+
+static const struct FieldColumn fieldColumns[RESULT_NB_FIELDS] = {
+    [RESULT_CHANGE_TIME_WITH_WRITE] = {"Change time (with write)", "cycles", true},
+    [RESULT_CHANGE_TIME] = {"Change time", "cycles", true},
+    [RESULT_WRITE_COST] = {"Write cost", "cycles", true},
+    [RESULT_WAIT_TIME] = {"Wait time", "us", false},
+    [RESULT_SINCE_CHANGE_REQUEST] = {"Time since last frequency change request", "cycles", true},
+    [RESULT_SINCE_CHANGE] = {"Time since last frequency change", "cycles", true},
+    [RESULT_DETECTION_TIMESTAMP] = {"Detected frequency change timestamp", "cycles", false},
+    [RESULT_ESTIMATED_CHANGE_TIME] = {"Estimated change time", "cycles", true},
+    [RESULT_ESTIMATE_ERROR] = {"Estimate error", "cycles", true},
+    [RESULT_DETECTION_CONFIDENCE] = {"Detection confidence", "per mille", false},
+};
+
+static void writeTable(FILE* out, struct PairResults const* pResults, bool microseconds) {
+  // The microsecond columns follow the raw ones, so that the text format keeps its column order
+  microseconds = microseconds && pResults->TscFrequency != 0;
+  double usPerCycle = microseconds ? 1e6 / pResults->TscFrequency : 0;
+
+  for (unsigned int field = 0; field < RESULT_NB_FIELDS; field++) {
+    fprintf(out, field > 0 ? "\t%s [%s]" : "%s [%s]", fieldColumns[field].Name, fieldColumns[field].Unit);
+  }
+  for (unsigned int field = 0; microseconds && field < RESULT_NB_FIELDS; field++) {
+    if (fieldColumns[field].Duration) {
+      fprintf(out, "\t%s [us]", fieldColumns[field].Name);
+    }
+  }
+  fprintf(out, "\n");
+
+  for (unsigned long i = 0; i < pResults->NbRepetitions; i++) {
+    for (unsigned int field = 0; field < RESULT_NB_FIELDS; field++) {
+      fprintf(out, field > 0 ? "\t%lu" : "%lu", pResults->pFields[field][i]);
+    }
+    for (unsigned int field = 0; microseconds && field < RESULT_NB_FIELDS; field++) {
+      if (fieldColumns[field].Duration) {
+        fprintf(out, "\t%.3f", pResults->pFields[field][i] * usPerCycle);
+      }
+    }
+    fprintf(out, "\n");
+  }
+}
+
+/*
+ * Write the outcome of the tests of the start and target loop timings
+ */
+static void writeTests(FILE* out, struct PairResults const* pResults) {
+  struct TestResult Result;
+
+  fprintf(out, "# Confidence level %g\n", getConfidenceLevel());
+  if (welchTest(&pResults->StartInterval, &pResults->TargetInterval, &Result)) {
+    fprintf(out, "# Welch's t-test: t = %.3f, p = %.3g\n", Result.Statistic, Result.PValue);
+  }
+  if (mannWhitneyTest(&pResults->StartInterval, &pResults->TargetInterval, &Result)) {
+    fprintf(out, "# Mann-Whitney U test: z = %.3f, p = %.3g\n", Result.Statistic, Result.PValue);
+  }
+}
+
+void writeTextResults(FILE* out, struct PairResults const* pResults, bool microseconds) {
+  if (pResults->TscFrequency != 0) {
+    fprintf(out, "# TSC frequency %lu Hz\n", pResults->TscFrequency);
+  }
+
+  if (pResults->pTargetLoopName != NULL) {
+    fprintf(out, "# Loop %s -> %s\n", pResults->pLoopName, pResults->pTargetLoopName);
+  } else if (pResults->pLoopName != NULL) {
+    fprintf(out, "# Loop %s\n", pResults->pLoopName);
+  }
+
+  if (pResults->pKnobName != NULL) {
+    fprintf(out, "# Knob %s, the start and target frequencies are its values\n", pResults->pKnobName);
+  }
+
+  if (pResults->Mode == RESULT_MODE_LOAD_STEP) {
+    fprintf(out, "# Frequency raised by the governor after a load step, the write cost is the wake-up latency and the "
+                 "estimated change time the reaction of the governor\n");
+  }
+
+  if (pResults->Mode == RESULT_MODE_IDLE_EXIT) {
+    fprintf(out, "# Exit from the idle state %s, the write cost is the time to the first instruction and the change "
+                 "time with write the time to the frequency\n",
+            pResults->pIdleStateName);
+    dump(out, &pResults->TargetInterval, pResults->TargetFreq, "Target");
+    writeTable(out, pResults, microseconds);
+    return;
+  }
+
+  if (pResults->Detector == DETECTOR_COUNTERS) {
+    fprintf(out, "# Frequency change detected with the cycle counters, no calibration\n");
+    writeTable(out, pResults, microseconds);
+    return;
+  }
+
+  if (pResults->Detector == DETECTOR_CUSUM) {
+    fprintf(out, "# Frequency change detected with a CUSUM of the loop timings\n");
+  }
+
+  dump(out, &pResults->StartInterval, pResults->StartFreq, "Start");
+  dump(out, &pResults->TargetInterval, pResults->TargetFreq, "Target");
+
+  writeTests(out, pResults);
+
+  // Check if the confidence intervals overlap, the tests decide then
+  bool different = differSignificantly(&pResults->StartInterval, &pResults->TargetInterval);
+  if (overlapSignificantly(&pResults->StartInterval, &pResults->TargetInterval) && !different) {
+    fprintf(out, "# Warning: confidence intervals overlap considerably, "
+                 "alternatives are equal with selected confidence level\n");
+    return;
+  } else if (overlap(&pResults->StartInterval, &pResults->TargetInterval) ||
+             overlapSignificantly(&pResults->StartInterval, &pResults->TargetInterval)) {
+    fprintf(out, different ? "# Confidence intervals overlap, the tests state that alternatives are statistically "
+                             "different with selected confidence level\n"
+                           : "# Warning: confidence intervals overlap and the tests can not tell the alternatives "
+                             "apart with selected confidence level\n");
+  } else {
+    fprintf(out, "# Confidence intervals do not overlap, alternatives are "
+                 "statistically different with selected confidence level\n");
+  }
+
+  writeTable(out, pResults, microseconds);
+}
+
+int writeBinaryResults(const char* pFileName, struct PairResults const* pResults) {
+  struct ResultHeader header = {
+      .Magic = RESULT_MAGIC,
+      .Version = RESULT_VERSION,
+      .HeaderSize = sizeof(struct ResultHeader),
+      .CoreID = pResults->CoreID,
+      .StartFreq = pResults->StartFreq,
+      .TargetFreq = pResults->TargetFreq,
+      .NbFields = RESULT_NB_FIELDS,
+      .NbRepetitions = pResults->NbRepetitions,
+      .TscFrequency = pResults->TscFrequency,
+      .WaitUs = pResults->WaitUs,
+      .WaitRandom = pResults->WaitRandom,
+      .Detector = pResults->Detector,
+      .Mode = pResults->Mode,
+  };
+  toResultInterval(&pResults->StartInterval, &header.StartInterval);
+  toResultInterval(&pResults->TargetInterval, &header.TargetInterval);
+  if (pResults->pIdleStateName != NULL) {
+    strncpy(header.IdleStateName, pResults->pIdleStateName, RESULT_IDLE_STATE_NAME_SIZE - 1);
+  }
+  if (pResults->pLoopName != NULL) {
+    strncpy(header.LoopName, pResults->pLoopName, RESULT_LOOP_NAME_SIZE - 1);
+  }
+  if (pResults->pTargetLoopName != NULL) {
+    strncpy(header.TargetLoopName, pResults->pTargetLoopName, RESULT_LOOP_NAME_SIZE - 1);
+  }
+
+  int fd = open(pFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "Fail to open %s\n", pFileName);
+    return -1;
+  }
+
+  int ret = writeAll(fd, &header, sizeof(header));
+  for (unsigned int field = 0; field < RESULT_NB_FIELDS && ret == 0; field++) {
+    ret = writeAll(fd, pResults->pFields[field], sizeof(uint64_t) * pResults->NbRepetitions);
+  }
+
+  close(fd);
+
+  return ret;
+}
+
+/*
+ * The name of the result file of a pair without extension
+ */
+static void resultFileName(char* pBuffer, const char* outputDir, struct PairResults const* pResults) {
+  if (pResults->pTargetLoopName != NULL) {
+    snprintf(pBuffer, PATH_MAX, "%s/%u-%s-%s-out", outputDir, pResults->StartFreq, pResults->pLoopName,
+             pResults->pTargetLoopName);
+  } else if (pResults->Mode == RESULT_MODE_IDLE_EXIT) {
+    snprintf(pBuffer, PATH_MAX, "%s/%u-%s-out", outputDir, pResults->StartFreq, pResults->pIdleStateName);
+  } else if (pResults->Mode == RESULT_MODE_LOAD_STEP) {
+    snprintf(pBuffer, PATH_MAX, "%s/%u_%u-load-step-out", outputDir, pResults->StartFreq, pResults->TargetFreq);
+  } else {
+    snprintf(pBuffer, PATH_MAX, "%s/%u_%u-out", outputDir, pResults->StartFreq, pResults->TargetFreq);
+  }
+}
+
+int writeResults(const char* outputDir, enum ResultFormat format, struct PairResults const* pResults) {
+  char filePathBuffer[PATH_MAX] = {'\0'};
+  char fileNameBuffer[PATH_MAX] = {'\0'};
+
+  if (outputDir != NULL) {
+    resultFileName(fileNameBuffer, outputDir, pResults);
+  }
+
+  if (format == RESULT_FORMAT_BINARY) {
+    snprintf(filePathBuffer, PATH_MAX, "%s.bin", fileNameBuffer);
+    return writeBinaryResults(filePathBuffer, pResults);
+  }
+
+  if (outputDir == NULL) {
+    if (pResults->pTargetLoopName != NULL) {
+      fprintf(stdout, "# Transition %s -> %s at %u\n", pResults->pLoopName, pResults->pTargetLoopName,
+              pResults->StartFreq);
+    } else if (pResults->Mode == RESULT_MODE_IDLE_EXIT) {
+      fprintf(stdout, "# Exit from %s at %u\n", pResults->pIdleStateName, pResults->StartFreq);
+    } else if (pResults->Mode == RESULT_MODE_LOAD_STEP) {
+      fprintf(stdout, "# Load step %u -> %u\n", pResults->StartFreq, pResults->TargetFreq);
+    } else {
+      fprintf(stdout, "# Transition %u -> %u\n", pResults->StartFreq, pResults->TargetFreq);
+    }
+    writeTextResults(stdout, pResults, format == RESULT_FORMAT_TEXT_US);
+    fflush(stdout);
+    return 0;
+  }
+
+  snprintf(filePathBuffer, PATH_MAX, "%s.txt", fileNameBuffer);
+  FILE* out = fopen(filePathBuffer, "w");
+  if (out == NULL) {
+    fprintf(stderr, "Fail to open %s\n", filePathBuffer);
+    return -1;
+  }
+
+  writeTextResults(out, pResults, format == RESULT_FORMAT_TEXT_US);
+  fclose(out);
+
+  return 0;
+}
+
+int readBinaryResults(const char* pFileName, struct PairResults* pResults) {
+  struct stat fileStat;
+
+  int fd = open(pFileName, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Fail to open %s\n", pFileName);
+    return -1;
+  }
+
+  if (fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(struct ResultHeader)) {
+    fprintf(stderr, "%s is not a result file\n", pFileName);
+    close(fd);
+    return -1;
+  }
+
+  void* pMapping = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (pMapping == MAP_FAILED) {
+    perror("mmap");
+    return -1;
+  }
+
+  struct ResultHeader const* pHeader = pMapping;
+  size_t fieldsSize = sizeof(uint64_t) * pHeader->NbRepetitions * pHeader->NbFields;
+  if (memcmp(pHeader->Magic, RESULT_MAGIC, sizeof(pHeader->Magic)) != 0 || pHeader->Version != RESULT_VERSION ||
+      pHeader->NbFields != RESULT_NB_FIELDS || (size_t)fileStat.st_size != pHeader->HeaderSize + fieldsSize ||
+      memchr(pHeader->IdleStateName, '\0', RESULT_IDLE_STATE_NAME_SIZE) == NULL ||
+      memchr(pHeader->LoopName, '\0', RESULT_LOOP_NAME_SIZE) == NULL ||
+      memchr(pHeader->TargetLoopName, '\0', RESULT_LOOP_NAME_SIZE) == NULL) {
+    fprintf(stderr, "%s is not a result file of version %d\n", pFileName, RESULT_VERSION);
+    munmap(pMapping, fileStat.st_size);
+    return -1;
+  }
+
+  pResults->CoreID = pHeader->CoreID;
+  pResults->StartFreq = pHeader->StartFreq;
+  pResults->TargetFreq = pHeader->TargetFreq;
+  fromResultInterval(&pHeader->StartInterval, &pResults->StartInterval);
+  fromResultInterval(&pHeader->TargetInterval, &pResults->TargetInterval);
+  pResults->TscFrequency = pHeader->TscFrequency;
+  pResults->WaitUs = pHeader->WaitUs;
+  pResults->WaitRandom = pHeader->WaitRandom;
+  pResults->Detector = pHeader->Detector;
+  pResults->pLoopName = pHeader->LoopName[0] != '\0' ? pHeader->LoopName : NULL;
+  pResults->pTargetLoopName = pHeader->Mode == RESULT_MODE_LOOP_TRANSITION ? pHeader->TargetLoopName : NULL;
+  pResults->Mode = pHeader->Mode;
+  pResults->pIdleStateName = pHeader->Mode == RESULT_MODE_IDLE_EXIT ? pHeader->IdleStateName : NULL;
+  pResults->pKnobName = NULL;
+  pResults->NbRepetitions = pHeader->NbRepetitions;
+
+  const unsigned long* pFields = (const unsigned long*)((const char*)pMapping + pHeader->HeaderSize);
+  for (unsigned int field = 0; field < RESULT_NB_FIELDS; field++) {
+    pResults->pFields[field] = pFields + field * pHeader->NbRepetitions;
+  }
+
+  pResults->pMapping = pMapping;
+  pResults->MappingSize = fileStat.st_size;
+
+  return 0;
+}
+
+void releaseBinaryResults(struct PairResults* pResults) {
+  if (pResults->pMapping != NULL) {
+    munmap(pResults->pMapping, pResults->MappingSize);
+    pResults->pMapping = NULL;
+  }
+}
@@ -0,0 +1,199 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RESULTWRITER_H
+#define RESULTWRITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ConfInterval.h"
+
+#define RESULT_MAGIC "FTALRES"
+#define RESULT_VERSION 4
+// Large enough for the names of the cpuidle states, e.g. C1E or C6
+#define RESULT_IDLE_STATE_NAME_SIZE 16
+// Large enough for the names of the loop kernels, e.g. fma512_128x8
+#define RESULT_LOOP_NAME_SIZE 32
+
+enum ResultFormat {
+  // Tab separated values, one row per repetition
+  RESULT_FORMAT_TEXT,
+  // Same as RESULT_FORMAT_TEXT, followed by the durations in microseconds of TSC time
+  RESULT_FORMAT_TEXT_US,
+  // Header followed by one packed array per field
+  RESULT_FORMAT_BINARY,
+};
+
+/*
+ * How the frequency change is detected
+ */
+enum Detector {
+  // The loop timing falls into the interquartile range calibrated at the target frequency
+  DETECTOR_INTERVAL,
+  // The frequency computed from the core cycles and reference cycles of each loop is close to the target, no
+  // calibration is needed
+  DETECTOR_COUNTERS,
+  // Page's CUSUM of the log-likelihood ratio of the loop timings between the calibrated target and start
+  // distributions crosses a threshold set by the confidence level
+  DETECTOR_CUSUM,
+};
+
+/*
+ * What caused the change the results measure
+ */
+enum ResultMode {
+  // A frequency request
+  RESULT_MODE_TRANSITION,
+  // A load step after a sleep, the governor raises the frequency
+  RESULT_MODE_LOAD_STEP,
+  // A wake-up from an idle state at a fixed frequency
+  RESULT_MODE_IDLE_EXIT,
+  // A change of loop at a fixed frequency, e.g. to a loop that needs another license
+  RESULT_MODE_LOOP_TRANSITION,
+};
+
+/*
+ * The per repetition fields, in the order of the text columns and of the binary arrays
+ */
+enum ResultField {
+  RESULT_CHANGE_TIME_WITH_WRITE,
+  RESULT_CHANGE_TIME,
+  RESULT_WRITE_COST,
+  RESULT_WAIT_TIME,
+  RESULT_SINCE_CHANGE_REQUEST,
+  RESULT_SINCE_CHANGE,
+  RESULT_DETECTION_TIMESTAMP,
+  // Only set by the CUSUM detector and the load steps, 0 otherwise
+  RESULT_ESTIMATED_CHANGE_TIME,
+  RESULT_ESTIMATE_ERROR,
+  RESULT_DETECTION_CONFIDENCE,
+  RESULT_NB_FIELDS,
+};
+
+/*
+ * The results of one (start, target) pair on one core
+ */
+struct PairResults {
+  unsigned int CoreID;
+  unsigned int StartFreq;
+  unsigned int TargetFreq;
+  enum Detector Detector;
+  // Name of the loop the change was detected with, NULL if unknown
+  const char* pLoopName;
+  // The loop changed to from pLoopName with RESULT_MODE_LOOP_TRANSITION, NULL otherwise
+  const char* pTargetLoopName;
+  enum ResultMode Mode;
+  // The idle state the core woke up from with RESULT_MODE_IDLE_EXIT, NULL otherwise
+  const char* pIdleStateName;
+  // The knob the start and target values were written to instead of a frequency, NULL otherwise (not stored in the
+  // binary format)
+  const char* pKnobName;
+  // Only set for the interval detector
+  struct ConfidenceInterval StartInterval;
+  struct ConfidenceInterval TargetInterval;
+  // TSC cycles per second
+  unsigned long TscFrequency;
+  unsigned long WaitUs;
+  bool WaitRandom;
+  // 0 if the pair was not measured because the intervals overlap
+  unsigned long NbRepetitions;
+  const unsigned long* pFields[RESULT_NB_FIELDS];
+  // The file mapping the fields point into, set by readBinaryResults
+  void* pMapping;
+  size_t MappingSize;
+};
+
+/*
+ * Confidence interval as stored in the binary header
+ */
+struct ResultInterval {
+  uint64_t NbSamples;
+  double Average;
+  double StandardDeviation;
+  uint64_t LowerBound;
+  uint64_t UpperBound;
+  uint64_t Q1;
+  uint64_t Q3;
+};
+
+/*
+ * Layout of a binary result file: this header followed by NbFields arrays of NbRepetitions uint64_t, all in host byte
+ * order
+ */
+struct ResultHeader {
+  char Magic[8];
+  uint32_t Version;
+  uint32_t HeaderSize;
+  uint32_t CoreID;
+  uint32_t StartFreq;
+  uint32_t TargetFreq;
+  uint32_t NbFields;
+  uint64_t NbRepetitions;
+  uint64_t TscFrequency;
+  uint64_t WaitUs;
+  uint32_t WaitRandom;
+  uint32_t Detector;
+  struct ResultInterval StartInterval;
+  struct ResultInterval TargetInterval;
+  uint32_t Mode;
+  uint32_t Reserved;
+  // Only set for RESULT_MODE_IDLE_EXIT, null terminated
+  char IdleStateName[RESULT_IDLE_STATE_NAME_SIZE];
+  // The loop the change was detected with, empty if unknown, null terminated
+  char LoopName[RESULT_LOOP_NAME_SIZE];
+  // Only set for RESULT_MODE_LOOP_TRANSITION, null terminated
+  char TargetLoopName[RESULT_LOOP_NAME_SIZE];
+};
+
+/**
+ * Write the results of a pair in the given format
+ * \param outputDir the results are written to outputDir/startFreq_targetFreq-out.txt (or .bin), to stdout if NULL.
+ * Loop transitions are written to outputDir/freq-startLoop-targetLoop-out.txt, load steps to
+ * outputDir/startFreq_targetFreq-load-step-out.txt.
+ * \param format the output format, the binary format needs an output directory
+ * \param pResults the results to write
+ * \return 0 if everything gone fine
+ */
+int writeResults(const char* outputDir, enum ResultFormat format, struct PairResults const* pResults);
+
+/**
+ * Write the results as tab separated values with the calibration as # comments
+ * \param microseconds append the durations in microseconds, converted with the TSC frequency of the results
+ */
+void writeTextResults(FILE* out, struct PairResults const* pResults, bool microseconds);
+
+/**
+ * Write the results into a binary file
+ * \return 0 if everything gone fine
+ */
+int writeBinaryResults(const char* pFileName, struct PairResults const* pResults);
+
+/**
+ * Map a binary result file, the fields of \a pResults point into the mapping
+ * \return 0 if everything gone fine
+ */
+int readBinaryResults(const char* pFileName, struct PairResults* pResults);
+
+/**
+ * Unmap the file mapped by readBinaryResults
+ */
+void releaseBinaryResults(struct PairResults* pResults);
+
+#endif
@@ -0,0 +1,232 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <x86intrin.h>
+
+#include "FreqGetter.h"
+#include "Simulation.h"
+#include "loop.h"
+#include "rdtsc.h"
+#include "utils.h"
+
+struct SimulatedCore {
+  pthread_mutex_t Lock;
+  // Frequency until ChangeTsc [kHz]
+  unsigned int Freq;
+  // Frequency from ChangeTsc on [kHz]
+  unsigned int RequestedFreq;
+  unsigned long ChangeTsc;
+  // Statistics of the injected latencies [us]
+  unsigned long NbChanges;
+  double LatencySum;
+  double LatencyMin;
+  double LatencyMax;
+};
+
+static struct SimulatedCore* pSimulatedCores = NULL;
+static unsigned int nbSimulatedCores = 0;
+static struct LatencyDistribution latencyDistribution;
+static unsigned long tscFrequencyKHz = 0;
+
+char parseLatencyDistribution(const char* spec, struct LatencyDistribution* pDistribution) {
+  int nbRead = 0;
+
+  pDistribution->B = 0;
+  if (sscanf(spec, "fixed:%lf%n", &pDistribution->A, &nbRead) == 1) {
+    pDistribution->Kind = LATENCY_FIXED;
+  } else if (sscanf(spec, "uniform:%lf:%lf%n", &pDistribution->A, &pDistribution->B, &nbRead) == 2 &&
+             pDistribution->A <= pDistribution->B) {
+    pDistribution->Kind = LATENCY_UNIFORM;
+  } else if (sscanf(spec, "normal:%lf:%lf%n", &pDistribution->A, &pDistribution->B, &nbRead) == 2) {
+    pDistribution->Kind = LATENCY_NORMAL;
+  } else if (sscanf(spec, "exponential:%lf%n", &pDistribution->A, &nbRead) == 1) {
+    pDistribution->Kind = LATENCY_EXPONENTIAL;
+  } else {
+    return -1;
+  }
+
+  return spec[nbRead] == '\0' && pDistribution->A >= 0 ? 0 : -1;
+}
+
+/*
+ * Uniform random number in [0, 1)
+ */
+static double uniformRandom() {
+  return (xorshf96() >> 11) * 0x1.0p-53;
+}
+
+static double sampleLatency() {
+  switch (latencyDistribution.Kind) {
+  case LATENCY_UNIFORM:
+    return latencyDistribution.A + uniformRandom() * (latencyDistribution.B - latencyDistribution.A);
+  case LATENCY_NORMAL: {
+    // Box-Muller transform, negative latencies are cut to 0
+    double normal = sqrt(-2 * log(1 - uniformRandom())) * cos(2 * M_PI * uniformRandom());
+    double latency = latencyDistribution.A + latencyDistribution.B * normal;
+    return latency > 0 ? latency : 0;
+  }
+  case LATENCY_EXPONENTIAL:
+    return -latencyDistribution.A * log(1 - uniformRandom());
+  case LATENCY_FIXED:
+  default:
+    return latencyDistribution.A;
+  }
+}
+
+static struct SimulatedCore* simulatedCore(unsigned int coreID) {
+  return &pSimulatedCores[coreID % nbSimulatedCores];
+}
+
+/*
+ * The frequency of a core at a point in time, the lock of the core must be held
+ */
+static unsigned int frequencyAt(struct SimulatedCore const* pCore, unsigned long tsc) {
+  return tsc >= pCore->ChangeTsc ? pCore->RequestedFreq : pCore->Freq;
+}
+
+/*
+ * Spin for SIMULATED_LOOP_CYCLES core cycles at the frequency of the simulated core the thread runs on. A frequency
+ * change during the loop is taken into account. The simulated duration is returned rather than the measured one, so
+ * that the jitter of the spin does not move the calibrated intervals.
+ */
+static unsigned long simulatedTimedLoop(unsigned long* pEndTime) {
+  struct SimulatedCore* pCore = simulatedCore(sched_getcpu());
+  unsigned long startTime = 0;
+  unsigned long endTime = 0;
+
+  sync_rdtsc1(startTime);
+
+  pthread_mutex_lock(&pCore->Lock);
+  unsigned int freq = frequencyAt(pCore, startTime);
+  unsigned int nextFreq = pCore->RequestedFreq;
+  unsigned long changeTsc = pCore->ChangeTsc;
+  pthread_mutex_unlock(&pCore->Lock);
+
+  // A core at 0 kHz would never end the loop, requestSimulatedFreq ignores such requests
+  assert(freq != 0 && nextFreq != 0);
+  unsigned long loopEnd = startTime + (double)SIMULATED_LOOP_CYCLES * tscFrequencyKHz / freq;
+  if (startTime < changeTsc && loopEnd > changeTsc) {
+    // The cycles left at the change are run at the new frequency
+    double cyclesLeft = SIMULATED_LOOP_CYCLES - (double)(changeTsc - startTime) * freq / tscFrequencyKHz;
+    loopEnd = changeTsc + cyclesLeft * tscFrequencyKHz / nextFreq;
+  }
+
+  while (__rdtsc() < loopEnd) {
+  }
+  sync_rdtsc2(endTime);
+
+  *pEndTime = endTime;
+  return loopEnd - startTime;
+}
+
+char openSimulation(struct LatencyDistribution const* pDistribution) {
+  nbSimulatedCores = getCoreNumber();
+  pSimulatedCores = calloc(nbSimulatedCores, sizeof(struct SimulatedCore));
+  if (pSimulatedCores == NULL) {
+    fprintf(stderr, "Fail to allocate memory for the simulated cores\n");
+    return -1;
+  }
+
+  latencyDistribution = *pDistribution;
+  tscFrequencyKHz = getTscFrequency() / 1000;
+
+  for (unsigned int i = 0; i < nbSimulatedCores; i++) {
+    pthread_mutex_init(&pSimulatedCores[i].Lock, NULL);
+    pSimulatedCores[i].Freq = tscFrequencyKHz;
+    pSimulatedCores[i].RequestedFreq = tscFrequencyKHz;
+    pSimulatedCores[i].LatencyMin = INFINITY;
+  }
+
+  loopKernel = (struct LoopKernel){
+      .Name = "simulated",
+      .pTimedLoop = simulatedTimedLoop,
+  };
+
+  return 0;
+}
+
+void closeSimulation(void) {
+  if (pSimulatedCores == NULL) {
+    return;
+  }
+
+  for (unsigned int i = 0; i < nbSimulatedCores; i++) {
+    struct SimulatedCore const* pCore = &pSimulatedCores[i];
+    if (pCore->NbChanges > 0) {
+      fprintf(stderr,
+              "Simulated core %u: %lu frequency changes, injected latency min %.2f us, average %.2f us, max %.2f us\n",
+              i, pCore->NbChanges, pCore->LatencyMin, pCore->LatencySum / pCore->NbChanges, pCore->LatencyMax);
+    }
+    pthread_mutex_destroy(&pSimulatedCores[i].Lock);
+  }
+
+  free(pSimulatedCores);
+  pSimulatedCores = NULL;
+}
+
+bool simulationEnabled(void) {
+  return pSimulatedCores != NULL;
+}
+
+void requestSimulatedFreq(unsigned int coreID, unsigned int freq) {
+  struct SimulatedCore* pCore = simulatedCore(coreID);
+  unsigned long now = __rdtsc();
+  double latency = sampleLatency();
+
+  if (freq == 0) {
+    fprintf(stderr, "A simulated core can not run at 0 kHz, the request is ignored\n");
+    return;
+  }
+
+  pthread_mutex_lock(&pCore->Lock);
+  // A change that did not take effect yet is replaced
+  pCore->Freq = frequencyAt(pCore, now);
+  if (freq != pCore->Freq) {
+    pCore->RequestedFreq = freq;
+    pCore->ChangeTsc = now + latency * tscFrequencyKHz / 1000;
+
+    pCore->NbChanges++;
+    pCore->LatencySum += latency;
+    pCore->LatencyMin = latency < pCore->LatencyMin ? latency : pCore->LatencyMin;
+    pCore->LatencyMax = latency > pCore->LatencyMax ? latency : pCore->LatencyMax;
+  } else {
+    pCore->RequestedFreq = freq;
+    pCore->ChangeTsc = now;
+  }
+  pthread_mutex_unlock(&pCore->Lock);
+}
+
+void waitSimulatedFreq(unsigned int coreID, unsigned int freq) {
+  struct SimulatedCore* pCore = simulatedCore(coreID);
+  unsigned int currentFreq = 0;
+
+  do {
+    pthread_mutex_lock(&pCore->Lock);
+    currentFreq = frequencyAt(pCore, __rdtsc());
+    pthread_mutex_unlock(&pCore->Lock);
+  } while (currentFreq != freq);
+}
@@ -0,0 +1,84 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stdbool.h>
+
+// Core cycles of one simulated loop, the 8 x 128 additions of the assembler loop
+#define SIMULATED_LOOP_CYCLES 1024
+
+enum LatencyKind {
+  LATENCY_FIXED,
+  LATENCY_UNIFORM,
+  LATENCY_NORMAL,
+  LATENCY_EXPONENTIAL,
+};
+
+/*
+ * Distribution of the injected transition latencies [us]
+ */
+struct LatencyDistribution {
+  enum LatencyKind Kind;
+  // fixed: the latency, uniform: the minimum, normal and exponential: the average
+  double A;
+  // uniform: the maximum, normal: the standard deviation
+  double B;
+};
+
+/**
+ * Parse a latency distribution: fixed:us, uniform:min:max, normal:average:sd or exponential:average
+ * \return 0 if everything gone fine
+ */
+char parseLatencyDistribution(const char* spec, struct LatencyDistribution* pDistribution);
+
+/**
+ * Simulate the frequency of every core in software. Each core starts at the TSC frequency, a requested frequency
+ * takes effect after a latency drawn from \a pDistribution. The measurement loop is replaced by a loop that spins for
+ * SIMULATED_LOOP_CYCLES core cycles at the simulated frequency of the core it runs on.
+ * \param pDistribution the distribution of the injected latencies
+ * \return 0 if everything gone fine
+ */
+char openSimulation(struct LatencyDistribution const* pDistribution);
+
+/**
+ * Print the injected latencies of each core to stderr and free the simulation
+ */
+void closeSimulation(void);
+
+/**
+ * Check if the frequencies are simulated
+ */
+bool simulationEnabled(void);
+
+/**
+ * Request a frequency of a simulated core
+ * \param coreID the core
+ * \param freq the frequency in kHz
+ */
+void requestSimulatedFreq(unsigned int coreID, unsigned int freq);
+
+/**
+ * Wait for a simulated core to run at a frequency
+ * \param coreID the core
+ * \param freq the frequency in kHz
+ */
+void waitSimulatedFreq(unsigned int coreID, unsigned int freq);
+
+#endif
@@ -0,0 +1,57 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "StreamingStats.h"
+
+void resetStreamingStats(struct StreamingStats* Stats) {
+  // Only the range of buckets that was touched needs to be cleared
+  if (Stats->NbSamples != 0) {
+    memset(&Stats->Buckets[Stats->MinBucket], 0, sizeof(unsigned int) * (Stats->MaxBucket - Stats->MinBucket + 1));
+  }
+
+  Stats->NbSamples = 0;
+  Stats->Sum = 0;
+  Stats->SumSquares = 0;
+  Stats->MinBucket = STATS_NB_BUCKETS - 1;
+  Stats->MaxBucket = 0;
+}
+
+void streamingQuantile(struct StreamingStats const* Stats, unsigned int Rank, unsigned long* LowBound,
+                       unsigned long* HighBound) {
+  unsigned int bucket = Stats->MinBucket;
+  unsigned int seen = Stats->Buckets[bucket];
+
+  assert(Rank < Stats->NbSamples);
+
+  while (seen <= Rank) {
+    bucket++;
+    seen += Stats->Buckets[bucket];
+  }
+
+  if (bucket < 2 * STATS_SUB_BUCKETS) {
+    *LowBound = bucket;
+    *HighBound = bucket;
+  } else {
+    unsigned int shift = bucket / STATS_SUB_BUCKETS - 1;
+    *LowBound = (unsigned long)(STATS_SUB_BUCKETS + bucket % STATS_SUB_BUCKETS) << shift;
+    *HighBound = *LowBound + (1ul << shift) - 1;
+  }
+}
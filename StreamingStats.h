@@ -0,0 +1,92 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAMINGSTATS_H
+#define STREAMINGSTATS_H
+
+/*
+ * Loop timings are counted in a log-linear histogram: values below 2^STATS_SUB_BUCKET_BITS have their own bucket,
+ * every power of two above is split in 2^STATS_SUB_BUCKET_BITS buckets. The relative width of a bucket is thus at most
+ * 1 / 2^STATS_SUB_BUCKET_BITS (0.4 %), values of 2^STATS_MAX_EXPONENT and more share the last bucket.
+ */
+#define STATS_SUB_BUCKET_BITS 8
+#define STATS_SUB_BUCKETS (1u << STATS_SUB_BUCKET_BITS)
+#define STATS_MAX_EXPONENT 32
+#define STATS_NB_BUCKETS ((STATS_MAX_EXPONENT - STATS_SUB_BUCKET_BITS + 1) * STATS_SUB_BUCKETS)
+
+/*
+ * Summary of a stream of loop timings that allows to build a confidence interval without storing the samples
+ */
+struct StreamingStats {
+  unsigned int NbSamples;
+  unsigned long Sum;
+  double SumSquares;
+  unsigned int MinBucket;
+  unsigned int MaxBucket;
+  unsigned int Buckets[STATS_NB_BUCKETS];
+};
+
+/*
+ * Remove all the samples from the stats. The stats must be zero initialized before the first reset.
+ */
+void resetStreamingStats(struct StreamingStats* Stats);
+
+/*
+ * Get the bucket holding the value of given rank (0 based, in ascending order)
+ * \arg Stats The stats to look at
+ * \arg Rank The rank of the value, must be lower than the number of samples
+ * \arg LowBound The smallest value that the bucket holds
+ * \arg HighBound The largest value that the bucket holds
+ */
+void streamingQuantile(struct StreamingStats const* Stats, unsigned int Rank, unsigned long* LowBound,
+                       unsigned long* HighBound);
+
+static inline unsigned int streamingBucket(unsigned long Value) {
+  if (Value < STATS_SUB_BUCKETS) {
+    return Value;
+  }
+
+  unsigned int exponent = 63 - __builtin_clzl(Value);
+  if (exponent >= STATS_MAX_EXPONENT) {
+    return STATS_NB_BUCKETS - 1;
+  }
+
+  unsigned int shift = exponent - STATS_SUB_BUCKET_BITS;
+  return (shift + 1) * STATS_SUB_BUCKETS + (unsigned int)((Value >> shift) - STATS_SUB_BUCKETS);
+}
+
+/*
+ * Add a sample to the stats in constant time
+ */
+static inline void addStreamingSample(struct StreamingStats* Stats, unsigned long Value) {
+  unsigned int bucket = streamingBucket(Value);
+
+  Stats->NbSamples++;
+  Stats->Sum += Value;
+  Stats->SumSquares += (double)Value * (double)Value;
+  Stats->Buckets[bucket]++;
+
+  if (bucket < Stats->MinBucket) {
+    Stats->MinBucket = bucket;
+  }
+  if (bucket > Stats->MaxBucket) {
+    Stats->MaxBucket = bucket;
+  }
+}
+
+#endif
@@ -0,0 +1,285 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+
+#include "FreqGetter.h"
+#include "FreqSetter.h"
+#include "Throughput.h"
+
+#include "loop.h"
+#include "rdtsc.h"
+
+// Number of consecutive loop timings inside the interquartile range of a frequency that tell the core runs at it
+#ifndef THROUGHPUT_CONFIRM_LOOPS
+#define THROUGHPUT_CONFIRM_LOOPS 3
+#endif
+// Time the loop keeps running after the last request of a rate, so that its change can still be observed [us]
+#define THROUGHPUT_DRAIN_US 10000
+
+// Even requests are for the target frequency, odd ones for the start frequency
+#define TARGET_INDEX 0
+#define START_INDEX 1
+
+enum RequestOutcome {
+  // The core reached the frequency before the next request
+  REQUEST_EFFECT,
+  // The core reached the frequency after the next request was issued
+  REQUEST_LATE,
+  // The core never ran at the frequency after this request
+  REQUEST_DROPPED,
+  // The core already ran at the frequency when the request was issued
+  REQUEST_UNCHANGED,
+  NB_REQUEST_OUTCOMES,
+};
+
+static const char* outcomeNames[NB_REQUEST_OUTCOMES] = {
+    [REQUEST_EFFECT] = "effect",
+    [REQUEST_LATE] = "late",
+    [REQUEST_DROPPED] = "dropped",
+    [REQUEST_UNCHANGED] = "unchanged",
+};
+
+/*
+ * The per request buffers of a rate, they reuse the per repetition buffers of the context
+ */
+struct Requests {
+  // TSC right before each request
+  unsigned long* pIssues;
+  unsigned long* pWriteCosts;
+  // TSC at the first loop of the change that followed each request, the issue TSC if the request changed nothing, 0 if
+  // no change followed it
+  unsigned long* pEffects;
+  // Delays of the requests that were followed, for their statistics
+  unsigned long* pDelays;
+  unsigned int NbRequests;
+};
+
+/* Attribute a change to the last request of its frequency that was issued before it, if that request is not followed
+ * yet */
+static void attributeChange(struct Requests* pRequests, unsigned int nbIssued, unsigned int freqIndex,
+                            unsigned long changeTime) {
+  for (unsigned int j = nbIssued; j-- > 0;) {
+    if (j % 2 == freqIndex && pRequests->pIssues[j] <= changeTime) {
+      if (pRequests->pEffects[j] == 0) {
+        pRequests->pEffects[j] = changeTime;
+      }
+      return;
+    }
+  }
+}
+
+static enum RequestOutcome requestOutcome(struct Requests const* pRequests, unsigned int j) {
+  if (pRequests->pEffects[j] == 0) {
+    return REQUEST_DROPPED;
+  }
+  if (pRequests->pEffects[j] == pRequests->pIssues[j]) {
+    return REQUEST_UNCHANGED;
+  }
+  if (j + 1 < pRequests->NbRequests && pRequests->pEffects[j] >= pRequests->pIssues[j + 1]) {
+    return REQUEST_LATE;
+  }
+  return REQUEST_EFFECT;
+}
+
+/*
+ * Issue the requests every period TSC cycles while running the loop, and follow the frequency the core runs at until
+ * THROUGHPUT_DRAIN_US after the last request. A request is issued late if the previous one took longer than the
+ * period.
+ */
+static void measureRate(struct MeasurementContext* ctx, unsigned int const* pFreqs,
+                        struct ConfidenceInterval const* Intervals, unsigned long period,
+                        struct Requests* pRequests) {
+  unsigned long drainCycles = THROUGHPUT_DRAIN_US * getTscFrequency() / 1000000;
+  unsigned int nbIssued = 0;
+  unsigned int observed = START_INDEX;
+  unsigned int candidate = START_INDEX;
+  unsigned int nbConfirmed = 0;
+  unsigned long candidateTime = 0;
+  unsigned long endTime = 0;
+  unsigned long nextIssue = 0;
+
+  sync_rdtsc1(endTime);
+  nextIssue = endTime;
+
+  while (nbIssued < pRequests->NbRequests || endTime - pRequests->pIssues[nbIssued - 1] < drainCycles) {
+    if (nbIssued < pRequests->NbRequests && endTime >= nextIssue) {
+      unsigned long afterWrite = 0;
+
+      sync_rdtsc1(pRequests->pIssues[nbIssued]);
+      setFreq(ctx->CoreID, pFreqs[nbIssued % 2]);
+      sync_rdtsc1(afterWrite);
+      pRequests->pWriteCosts[nbIssued] = afterWrite - pRequests->pIssues[nbIssued];
+      pRequests->pEffects[nbIssued] = nbIssued % 2 == observed ? pRequests->pIssues[nbIssued] : 0;
+      nextIssue += period;
+      nbIssued++;
+    }
+
+    unsigned long time = timedLoop(ctx->pLoopKernel, &endTime);
+    if (ctx->pTracer != NULL) {
+      traceSample(ctx->pTracer, endTime, time, nbIssued, 0);
+    }
+
+    unsigned int band = observed;
+    for (unsigned int k = 0; k < 2; k++) {
+      if (time >= Intervals[k].Q1 && time <= Intervals[k].Q3) {
+        band = k;
+      }
+    }
+
+    // Timings between both ranges or at the current frequency break a run of the other frequency
+    if (band == observed) {
+      nbConfirmed = 0;
+      continue;
+    }
+    if (nbConfirmed == 0 || band != candidate) {
+      candidate = band;
+      candidateTime = endTime;
+      nbConfirmed = 0;
+    }
+    if (++nbConfirmed == THROUGHPUT_CONFIRM_LOOPS) {
+      observed = band;
+      nbConfirmed = 0;
+      attributeChange(pRequests, nbIssued, band, candidateTime);
+    }
+  }
+}
+
+/*
+ * Write the outcome of each request of a rate and a summary of them
+ */
+static void writeRate(FILE* out, unsigned int rate, unsigned int const* pFreqs, struct Requests* pRequests) {
+  unsigned int nbOutcomes[NB_REQUEST_OUTCOMES] = {0};
+  unsigned int nbDelays = 0;
+  unsigned long lastEffect = pRequests->pIssues[0];
+  double tscFrequency = getTscFrequency();
+  unsigned int n = pRequests->NbRequests;
+
+  for (unsigned int j = 0; j < n; j++) {
+    enum RequestOutcome outcome = requestOutcome(pRequests, j);
+
+    nbOutcomes[outcome]++;
+    if (outcome == REQUEST_EFFECT || outcome == REQUEST_LATE) {
+      pRequests->pDelays[nbDelays++] = pRequests->pEffects[j] - pRequests->pIssues[j];
+      if (pRequests->pEffects[j] > lastEffect) {
+        lastEffect = pRequests->pEffects[j];
+      }
+    }
+  }
+
+  fprintf(out, "# Rate %u/s: %u requests issued at %.0f/s, %u took effect, %u late, %u dropped or coalesced, %u "
+               "unchanged\n",
+          rate, n, n > 1 ? (n - 1) * tscFrequency / (pRequests->pIssues[n - 1] - pRequests->pIssues[0]) : 0,
+          nbOutcomes[REQUEST_EFFECT], nbOutcomes[REQUEST_LATE], nbOutcomes[REQUEST_DROPPED],
+          nbOutcomes[REQUEST_UNCHANGED]);
+  fprintf(out, "# Rate %u/s: sustained %.0f transitions/s\n", rate,
+          lastEffect > pRequests->pIssues[0] ? nbDelays * tscFrequency / (lastEffect - pRequests->pIssues[0]) : 0);
+  if (nbDelays > 1) {
+    struct ConfidenceInterval Delays;
+
+    buildFromMeasurement(pRequests->pDelays, nbDelays, &Delays);
+    fprintf(out, "# Rate %u/s: delay %.0f cycles on average, Q1 : %lu ; Q3 : %lu\n", rate, Delays.Average, Delays.Q1,
+            Delays.Q3);
+  }
+
+  for (unsigned int j = 0; j < n; j++) {
+    enum RequestOutcome outcome = requestOutcome(pRequests, j);
+    unsigned long delay =
+        outcome == REQUEST_EFFECT || outcome == REQUEST_LATE ? pRequests->pEffects[j] - pRequests->pIssues[j] : 0;
+
+    fprintf(out, "%u\t%u\t%u\t%lu\t%lu\t%s\t%lu\n", rate, j, pFreqs[j % 2],
+            pRequests->pIssues[j] - pRequests->pIssues[0], pRequests->pWriteCosts[j], outcomeNames[outcome], delay);
+  }
+}
+
+int runThroughput(struct MeasurementContext* ctx, unsigned int startFreq, unsigned int targetFreq,
+                  unsigned int const* pRates, unsigned int nbRates, const char* outputDir) {
+  unsigned int freqs[2] = {[TARGET_INDEX] = targetFreq, [START_INDEX] = startFreq};
+  struct ConfidenceInterval Intervals[2];
+  struct Requests requests = {
+      .pIssues = ctx->Results.pTimestamps,
+      .pWriteCosts = ctx->Results.pWriteCosts,
+      .pEffects = ctx->Results.pMeasurementsLate,
+      .pDelays = ctx->Results.pMeasurements,
+      .NbRequests = measurementConfig.NbReportTimes,
+  };
+  FILE* out = stdout;
+
+  fprintf(stderr, "Core %u: calibrating %u with %s\n", ctx->CoreID, targetFreq, ctx->pLoopKernel->Name);
+  calibrate(ctx, targetFreq, &Intervals[TARGET_INDEX]);
+  fprintf(stderr, "Core %u: calibrating %u with %s\n", ctx->CoreID, startFreq, ctx->pLoopKernel->Name);
+  calibrate(ctx, startFreq, &Intervals[START_INDEX]);
+
+  if (outputDir != NULL) {
+    char fileName[PATH_MAX];
+
+    snprintf(fileName, PATH_MAX, "%s/%u_%u-throughput.txt", outputDir, startFreq, targetFreq);
+    out = fopen(fileName, "w");
+    if (out == NULL) {
+      fprintf(stderr, "Fail to open %s\n", fileName);
+    }
+  }
+
+  bool followed = !overlapSignificantly(&Intervals[START_INDEX], &Intervals[TARGET_INDEX]) ||
+                  differSignificantly(&Intervals[START_INDEX], &Intervals[TARGET_INDEX]);
+  if (out != NULL) {
+    fprintf(out, "# TSC frequency %lu Hz\n", getTscFrequency());
+    if (getKnobName() != NULL) {
+      fprintf(out, "# Knob %s, the start and target frequencies are its values\n", getKnobName());
+    }
+    dump(out, &Intervals[START_INDEX], startFreq, "Start");
+    dump(out, &Intervals[TARGET_INDEX], targetFreq, "Target");
+
+    if (followed) {
+      fprintf(out, "Rate [1/s]\tRequest\tFrequency [kHz]\tIssue time [cycles]\tWrite cost [cycles]\tOutcome\tDelay "
+                   "[cycles]\n");
+    } else {
+      fprintf(out, "# Warning: loop timings do not differ significantly, the requests can not be followed\n");
+    }
+  }
+
+  for (unsigned int r = 0; r < nbRates; r++) {
+    setFreq(ctx->CoreID, startFreq);
+    waitCurFreq(ctx->CoreID, startFreq);
+    // Wait 10ms for settling of the frequency
+    busyWait(10000);
+    // Every core reaches the barrier once per rate, even if it skips the rate, so that the others do not wait forever
+    synchronize(ctx);
+    if (out == NULL || !followed) {
+      continue;
+    }
+
+    fprintf(stderr, "Core %u: requesting %u <-> %u at %u/s\n", ctx->CoreID, startFreq, targetFreq, pRates[r]);
+    measureRate(ctx, freqs, Intervals, getTscFrequency() / pRates[r], &requests);
+    if (ctx->pTracer != NULL) {
+      flushTracer(ctx->pTracer);
+    }
+
+    writeRate(out, pRates[r], freqs, &requests);
+  }
+
+  if (out == NULL) {
+    return -1;
+  }
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  return 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THROUGHPUT_H
+#define THROUGHPUT_H
+
+#include "Measurement.h"
+
+// Number of request rates that can be measured in one run
+#define NB_MAX_RATES 32
+
+/**
+ * Issue frequency requests alternating between targetFreq and startFreq at each of the given rates, without waiting
+ * for them to take effect, and detect which requests the core follows.
+ * The loop runs between the requests and the core is considered at a frequency once THROUGHPUT_CONFIRM_LOOPS
+ * consecutive loop timings are inside its calibrated interquartile range. The change is then attributed to the last
+ * request of that frequency issued before it: the request took effect if this was before the next request, late
+ * otherwise. Requests that are never followed were dropped or coalesced with a later one, requests of the frequency
+ * the core already runs at are unchanged.
+ * Each rate issues NbReportTimes requests, the results are written to outputDir/start_target-throughput.txt.
+ * \param ctx the measurement context of the calling thread
+ * \param startFreq the frequency the core runs at before the first request of each rate
+ * \param targetFreq the frequency of the first request
+ * \param pRates the request rates [1/s]
+ * \param nbRates the number of rates
+ * \param outputDir the directory where the results are written, stdout if NULL
+ * \return 0 if everything gone fine
+ */
+int runThroughput(struct MeasurementContext* ctx, unsigned int startFreq, unsigned int targetFreq,
+                  unsigned int const* pRates, unsigned int nbRates, const char* outputDir);
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "Tracer.h"
+#include "utils.h"
+
+struct Tracer* openTracer(const char* pFileName, unsigned int coreID) {
+  struct TraceHeader header = {
+      .Magic = TRACE_MAGIC,
+      .Version = TRACE_VERSION,
+      .RecordSize = sizeof(struct TraceRecord),
+      .CoreID = coreID,
+      .Reserved = 0,
+      .NbRecords = 0,
+      .NbDropped = 0,
+  };
+
+  struct Tracer* pTracer = calloc(1, sizeof(struct Tracer));
+  if (pTracer == NULL) {
+    fprintf(stderr, "Fail to allocate memory for the tracer\n");
+    return NULL;
+  }
+  pTracer->CoreID = coreID;
+
+  // The ring is faulted in now, so that recording never page faults
+  pTracer->pRing = mmap(NULL, sizeof(struct TraceRecord) * TRACE_RING_RECORDS, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+  if (pTracer->pRing == MAP_FAILED) {
+    perror("mmap");
+    free(pTracer);
+    return NULL;
+  }
+  memset(pTracer->pRing, 0, sizeof(struct TraceRecord) * TRACE_RING_RECORDS);
+
+  pTracer->Fd = open(pFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (pTracer->Fd < 0) {
+    fprintf(stderr, "Error to open trace file %s\n", pFileName);
+    munmap(pTracer->pRing, sizeof(struct TraceRecord) * TRACE_RING_RECORDS);
+    free(pTracer);
+    return NULL;
+  }
+
+  writeAll(pTracer->Fd, &header, sizeof(header));
+
+  return pTracer;
+}
+
+void flushTracer(struct Tracer* pTracer) {
+  uint64_t nbPending = pTracer->Head - pTracer->Flushed;
+
+  if (nbPending > TRACE_RING_RECORDS) {
+    pTracer->NbDropped += nbPending - TRACE_RING_RECORDS;
+    pTracer->Flushed = pTracer->Head - TRACE_RING_RECORDS;
+  }
+
+  while (pTracer->Flushed < pTracer->Head) {
+    // Write up to the end of the ring, the rest starts again at its beginning
+    uint64_t first = pTracer->Flushed & (TRACE_RING_RECORDS - 1);
+    uint64_t count = pTracer->Head - pTracer->Flushed;
+    if (first + count > TRACE_RING_RECORDS) {
+      count = TRACE_RING_RECORDS - first;
+    }
+
+    writeAll(pTracer->Fd, &pTracer->pRing[first], sizeof(struct TraceRecord) * count);
+    pTracer->Flushed += count;
+  }
+}
+
+void closeTracer(struct Tracer* pTracer) {
+  if (pTracer == NULL) {
+    return;
+  }
+
+  flushTracer(pTracer);
+
+  uint64_t counts[2] = {pTracer->Flushed - pTracer->NbDropped, pTracer->NbDropped};
+  if (pwrite(pTracer->Fd, counts, sizeof(counts), offsetof(struct TraceHeader, NbRecords)) != sizeof(counts)) {
+    perror("pwrite");
+  }
+
+  close(pTracer->Fd);
+  munmap(pTracer->pRing, sizeof(struct TraceRecord) * TRACE_RING_RECORDS);
+  free(pTracer);
+}
@@ -0,0 +1,107 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <stdint.h>
+
+// Number of records the ring buffer of a tracer holds, must be a power of two
+#define TRACE_RING_RECORDS (1u << 20)
+// Iteration id of the samples taken outside of the benchmark repetitions (calibration)
+#define TRACE_NO_ITERATION UINT32_MAX
+
+#define TRACE_MAGIC "FTALTRC"
+#define TRACE_VERSION 2
+
+/*
+ * Layout of the trace file: one header followed by the records, all in host byte order
+ */
+struct TraceHeader {
+  char Magic[8];
+  uint32_t Version;
+  uint32_t RecordSize;
+  uint32_t CoreID;
+  uint32_t Reserved;
+  // Updated when the tracer is closed
+  uint64_t NbRecords;
+  uint64_t NbDropped;
+};
+
+struct TraceRecord {
+  // Timestamp at the end of the loop
+  uint64_t Tsc;
+  uint32_t LoopCycles;
+  uint32_t Iteration;
+  // Frequency computed from the cycle counters [kHz], 0 if the counters are not read
+  uint32_t Frequency;
+  uint32_t Reserved;
+};
+
+/*
+ * Records loop samples into a pre-faulted ring buffer with plain stores. The records are only written to the file
+ * when the tracer is flushed, which is done between the benchmark repetitions.
+ */
+struct Tracer {
+  int Fd;
+  struct TraceRecord* pRing;
+  // Number of records written to the ring and to the file so far
+  uint64_t Head;
+  uint64_t Flushed;
+  uint64_t NbDropped;
+  uint32_t CoreID;
+};
+
+/**
+ * Create a tracer and the file it writes to
+ * \param pFileName the trace file
+ * \param coreID the core that is traced, stored in the header
+ * \return the tracer, NULL on failure
+ */
+struct Tracer* openTracer(const char* pFileName, unsigned int coreID);
+
+/**
+ * Write the records of the ring buffer to the file. If the ring wrapped since the last flush, the oldest records
+ * are dropped.
+ */
+void flushTracer(struct Tracer* pTracer);
+
+/**
+ * Flush the tracer, complete the header and free the tracer
+ */
+void closeTracer(struct Tracer* pTracer);
+
+/**
+ * Record a loop sample, no system call is made
+ * \param pTracer the tracer
+ * \param tsc the timestamp at the end of the loop
+ * \param loopCycles the number of TSC cycles the loop took
+ * \param iteration the benchmark repetition the sample belongs to
+ * \param frequency the frequency during the loop in kHz, 0 if unknown
+ */
+static inline void traceSample(struct Tracer* pTracer, unsigned long tsc, unsigned long loopCycles,
+                               uint32_t iteration, uint32_t frequency) {
+  struct TraceRecord* pRecord = &pTracer->pRing[pTracer->Head & (TRACE_RING_RECORDS - 1)];
+  pRecord->Tsc = tsc;
+  pRecord->LoopCycles = loopCycles;
+  pRecord->Iteration = iteration;
+  pRecord->Frequency = frequency;
+  pTracer->Head++;
+}
+
+#endif
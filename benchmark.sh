@@ -42,30 +42,21 @@ echo off | sudo tee /sys/devices/system/cpu/smt/control
 
 # measurement for long
 make clean
+make
 if [ $scaling_available_frequencies_found -eq 0 ]
 then
-	export MORE_FLAGS="-DNB_WAIT_RANDOM -DNB_WAIT_US=5000 -DNB_REPORT_TIMES=1000 -DFREQ_SETTER_FILE=\\\"scaling_setspeed\\\""
+	setter_file=scaling_setspeed
 else
-	export MORE_FLAGS="-DNB_WAIT_RANDOM -DNB_WAIT_US=5000 -DNB_REPORT_TIMES=1000 -DFREQ_SETTER_FILE=\\\"scaling_max_freq\\\""
+	setter_file=scaling_max_freq
 fi
-make
 
 rm -rf results/$HOSTNAME || true
 mkdir -p results/$HOSTNAME
 
-for START in "${frequencies[@]}"
-do
-	for TARGET in "${frequencies[@]}"
-	do
-		if [ $START -eq $TARGET ] 
-		then
-			echo "Skip $START -> $TARGET (same frequency)"
-			continue
-		fi
-		echo "Running $START -> $TARGET"
-		sudo ./ftalat $START $TARGET > results/$HOSTNAME/${START}_${TARGET}-out_random_5000us_1000sa.txt
-	done
-done
+# Calibrate each frequency once and measure all pairs in one process
+frequency_list=$(IFS=,; echo "${frequencies[*]}")
+sudo ./ftalat --sweep --frequencies $frequency_list --output results/$HOSTNAME \
+	--random-wait --wait 5000 --repetitions 1000 --setter-file $setter_file
 
 # Take all cpus online again
 echo on | sudo tee /sys/devices/system/cpu/smt/control
@@ -0,0 +1,66 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ResultWriter.h"
+
+/*
+ * Convert binary result files (--format binary) back into the text format
+ */
+int main(int argc, char** argv) {
+  bool microseconds = argc > 1 && strcmp(argv[1], "-u") == 0;
+  if (microseconds) {
+    argc--;
+    argv++;
+  }
+
+  if (argc < 2 || argc > 3) {
+    fprintf(stdout, "./ftalat_convert [-u] resultFile.bin [output.txt]\n");
+    fprintf(stdout, "\tprints the results of a binary result file as tab separated values, to stdout by default\n");
+    fprintf(stdout, "\t-u\t:\tappend the durations in us, converted with the TSC frequency of the file\n");
+    return -1;
+  }
+
+  struct PairResults results = {0};
+  if (readBinaryResults(argv[1], &results) != 0) {
+    return -2;
+  }
+
+  FILE* out = stdout;
+  if (argc == 3) {
+    out = fopen(argv[2], "w");
+    if (out == NULL) {
+      fprintf(stderr, "Fail to open %s\n", argv[2]);
+      releaseBinaryResults(&results);
+      return -3;
+    }
+  }
+
+  fprintf(out, "# Core %u, wait %lu us (%s)\n", results.CoreID, results.WaitUs,
+          results.WaitRandom ? "random" : "fixed");
+  writeTextResults(out, &results, microseconds);
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  releaseBinaryResults(&results);
+
+  return 0;
+}
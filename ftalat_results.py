@@ -0,0 +1,281 @@
+"""Load the result files and the traces written by ftalat.
+
+The binary files (--format binary, --trace) are memory-mapped with numpy, so that loading a full sweep only reads the
+headers. The text files are still supported for results written with --format text.
+"""
+
+import glob
+import os
+import re
+
+import numpy as np
+import pandas as pd
+
+# The per repetition fields, in the order of the text columns and of the binary arrays
+FIELDS = [
+    "Change time (with write) [cycles]",
+    "Change time [cycles]",
+    "Write cost [cycles]",
+    "Wait time [us]",
+    "Time since last frequency change request [cycles]",
+    "Time since last frequency change [cycles]",
+    "Detected frequency change timestamp [cycles]",
+    "Estimated change time [cycles]",
+    "Estimate error [cycles]",
+    "Detection confidence [per mille]",
+]
+
+# The fields that are durations in TSC cycles, --format text-us appends them in microseconds
+DURATION_FIELDS = [name for name in FIELDS if name.endswith("[cycles]") and "timestamp" not in name]
+MICROSECOND_FIELDS = [name.replace("[cycles]", "[us]") for name in DURATION_FIELDS]
+
+# The TSC frequency line of the text header
+TSC_FREQUENCY_LINE = re.compile(r"^# TSC frequency (\d+) Hz$")
+
+RESULT_MAGIC = b"FTALRES"
+RESULT_VERSION = 4
+
+# Name of the result file of a frequency pair, the license transitions (freq-startLoop-targetLoop-out) are skipped
+PAIR_FILE = re.compile(r"^(\d+)_(\d+)-out\.(bin|txt)$")
+
+# Values of the mode field of the header, load_folder only yields the transitions
+MODE_TRANSITION = 0
+MODE_LOAD_STEP = 1
+MODE_IDLE_EXIT = 2
+MODE_LOOP_TRANSITION = 3
+
+# Values of the detector field of the header
+DETECTOR_INTERVAL = 0
+DETECTOR_COUNTERS = 1
+DETECTOR_CUSUM = 2
+
+INTERVAL = np.dtype([
+    ("samples", "<u8"),
+    ("average", "<f8"),
+    ("standard_deviation", "<f8"),
+    ("lower_bound", "<u8"),
+    ("upper_bound", "<u8"),
+    ("q1", "<u8"),
+    ("q3", "<u8"),
+])
+
+RESULT_HEADER = np.dtype([
+    ("magic", "S8"),
+    ("version", "<u4"),
+    ("header_size", "<u4"),
+    ("core", "<u4"),
+    ("start_frequency", "<u4"),
+    ("target_frequency", "<u4"),
+    ("fields", "<u4"),
+    ("repetitions", "<u8"),
+    ("tsc_frequency", "<u8"),
+    ("wait_us", "<u8"),
+    ("wait_random", "<u4"),
+    ("detector", "<u4"),
+    ("start_interval", INTERVAL),
+    ("target_interval", INTERVAL),
+    ("mode", "<u4"),
+    ("reserved", "<u4"),
+    ("idle_state", "S16"),
+    ("loop", "S32"),
+    ("target_loop", "S32"),
+])
+
+TRACE_MAGIC = b"FTALTRC"
+TRACE_VERSION = 2
+# Iteration of the samples taken during the calibration
+TRACE_NO_ITERATION = 0xFFFFFFFF
+
+TRACE_HEADER = np.dtype([
+    ("magic", "S8"),
+    ("version", "<u4"),
+    ("record_size", "<u4"),
+    ("core", "<u4"),
+    ("reserved", "<u4"),
+    ("records", "<u8"),
+    ("dropped", "<u8"),
+])
+
+TRACE_RECORD = np.dtype([
+    ("tsc", "<u8"),
+    ("cycles", "<u4"),
+    ("iteration", "<u4"),
+    ("frequency", "<u4"),
+    ("reserved", "<u4"),
+])
+
+RAMP_MAGIC = b"FTALRMP"
+RAMP_VERSION = 2
+
+RAMP_HEADER = np.dtype([
+    ("magic", "S8"),
+    ("version", "<u4"),
+    ("record_size", "<u4"),
+    ("core", "<u4"),
+    ("start_frequency", "<u4"),
+    ("target_frequency", "<u4"),
+    ("records_per_repetition", "<u4"),
+    ("repetitions", "<u8"),
+    ("tsc_frequency", "<u8"),
+    ("after_us", "<u8"),
+])
+
+RAMP_RECORD = np.dtype([
+    ("since_write", "<u8"),
+    ("cycles", "<u4"),
+    ("reserved", "<u4"),
+])
+
+# Each repetition of a ramp file is followed by its records
+RAMP_REPETITION = np.dtype([
+    ("iteration", "<u4"),
+    ("records", "<u4"),
+    ("dropped", "<u4"),
+    ("validated", "<u4"),
+    ("detection_time", "<u8"),
+])
+
+
+def load_results(path):
+    """Map a binary result file.
+
+    Returns the header and a dict from the field names to read-only arrays of the repetitions.
+    """
+    header = np.fromfile(path, dtype=RESULT_HEADER, count=1)[0]
+    if header["magic"] != RESULT_MAGIC or header["version"] != RESULT_VERSION:
+        raise ValueError(f"{path} is not a result file of version {RESULT_VERSION}")
+
+    shape = (int(header["fields"]), int(header["repetitions"]))
+    if shape[1] == 0:
+        # The pair was not measured, numpy can not map an empty range
+        columns = np.empty(shape, dtype="<u8")
+    else:
+        columns = np.memmap(path, dtype="<u8", mode="r", offset=int(header["header_size"]), shape=shape)
+
+    return header, {name: columns[i] for i, name in enumerate(FIELDS)}
+
+
+def load_trace(path):
+    """Map a trace file.
+
+    Returns the header and a structured array with the fields tsc, cycles, iteration and frequency (kHz, 0 if the
+    counters were not read).
+    """
+    header = np.fromfile(path, dtype=TRACE_HEADER, count=1)[0]
+    if header["magic"] != TRACE_MAGIC or header["version"] != TRACE_VERSION:
+        raise ValueError(f"{path} is not a trace file of version {TRACE_VERSION}")
+
+    if header["records"] == 0:
+        return header, np.empty(0, dtype=TRACE_RECORD)
+    return header, np.memmap(path, dtype=TRACE_RECORD, mode="r", offset=TRACE_HEADER.itemsize,
+                             shape=(int(header["records"]),))
+
+
+def load_ramp(path):
+    """Map a ramp file.
+
+    Returns the header, a structured array with one entry per repetition: iteration, records (the number of samples),
+    dropped, validated and detection_time (cycles from the request), and the list of the samples of each repetition,
+    whose since_write (cycles from the request to the end of the loop) and cycles fields are aligned to the frequency
+    request.
+    """
+    header = np.fromfile(path, dtype=RAMP_HEADER, count=1)[0]
+    if header["magic"] != RAMP_MAGIC or header["version"] != RAMP_VERSION:
+        raise ValueError(f"{path} is not a ramp file of version {RAMP_VERSION}")
+
+    repetitions = np.empty(int(header["repetitions"]), dtype=RAMP_REPETITION)
+    samples = []
+    if len(repetitions) == 0:
+        return header, repetitions, samples
+
+    data = np.memmap(path, dtype=np.uint8, mode="r")
+    offset = RAMP_HEADER.itemsize
+    for i in range(len(repetitions)):
+        repetitions[i] = np.frombuffer(data, dtype=RAMP_REPETITION, count=1, offset=offset)[0]
+        offset += RAMP_REPETITION.itemsize
+        count = int(repetitions[i]["records"])
+        samples.append(np.frombuffer(data, dtype=RAMP_RECORD, count=count, offset=offset))
+        offset += count * RAMP_RECORD.itemsize
+
+    return header, repetitions, samples
+
+
+def mean_ramp(path, bin_cycles=1000):
+    """Average the validated repetitions of a ramp file into a mean ramp profile.
+
+    The samples are binned by the end of their loop, in bins of bin_cycles TSC cycles from the frequency request.
+    Returns a DataFrame with the start of each bin, the mean and standard deviation of the loop cycles in it and the
+    number of samples.
+    """
+    _, repetitions, samples = load_ramp(path)
+    valid = [samples[i] for i in np.flatnonzero(repetitions["validated"] != 0)]
+    samples = np.concatenate(valid) if valid else np.empty(0, dtype=RAMP_RECORD)
+
+    data = pd.DataFrame({
+        "Time since write [cycles]": samples["since_write"] // bin_cycles * bin_cycles,
+        "Loop time [cycles]": samples["cycles"].astype(np.float64),
+    })
+    grouped = data.groupby("Time since write [cycles]")["Loop time [cycles]"]
+    return pd.DataFrame({
+        "Mean loop time [cycles]": grouped.mean(),
+        "Loop time sd [cycles]": grouped.std(),
+        "Samples": grouped.size(),
+    }).reset_index()
+
+
+def text_tsc_frequency(path):
+    """Read the TSC frequency from the header of a text result file, None for files written before it was added."""
+    with open(path) as file:
+        for line in file:
+            if not line.startswith("#"):
+                break
+            match = TSC_FREQUENCY_LINE.match(line.strip())
+            if match:
+                return int(match.group(1))
+    return None
+
+
+def to_microseconds(data):
+    """Add the microsecond columns of the durations to a DataFrame of load_folder, if its TSC frequency is known."""
+    tsc_frequency = data.attrs.get("tsc_frequency")
+    if tsc_frequency:
+        for cycles, us in zip(DURATION_FIELDS, MICROSECOND_FIELDS):
+            if cycles in data.columns:
+                data[us] = data[cycles] * 1e6 / tsc_frequency
+    return data
+
+
+def load_folder(folder):
+    """Load all the pairs of a result folder, binary or text.
+
+    Yields (start frequency, target frequency, DataFrame with one column per field) for each pair that was measured.
+    The TSC frequency in Hz is in data.attrs["tsc_frequency"], missing for text files written before it was added.
+    """
+    for file in sorted(glob.glob(os.path.join(folder, "*-out.bin"))):
+        if not PAIR_FILE.match(os.path.basename(file)):
+            continue
+        header, columns = load_results(file)
+        if header["repetitions"] == 0:
+            continue
+        data = pd.DataFrame(columns)
+        data.attrs["tsc_frequency"] = int(header["tsc_frequency"])
+        yield int(header["start_frequency"]), int(header["target_frequency"]), data
+
+    for file in sorted(glob.glob(os.path.join(folder, "*-out.txt"))):
+        match = PAIR_FILE.match(os.path.basename(file))
+        if not match:
+            continue
+        start, target = match.group(1), match.group(2)
+        try:
+            data = pd.read_csv(file, sep="\t", comment="#")
+        except pd.errors.EmptyDataError:
+            continue
+        # Text files written before the CUSUM detector have the first 7 fields only, --format text-us adds the
+        # microsecond columns after the fields
+        columns = list(data.columns)
+        if columns != FIELDS[:len(columns)] and columns != FIELDS + MICROSECOND_FIELDS or len(columns) < 7:
+            continue
+        tsc_frequency = text_tsc_frequency(file)
+        if tsc_frequency is not None:
+            data.attrs["tsc_frequency"] = tsc_frequency
+        yield int(start), int(target), data
@@ -16,10 +16,9 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-# Script to bench all the frequencies couple with ftalat
+# Script to bench all the frequencies couple with ftalat, the results of each pair of iteration i are written to
+# Results/i/start_target-out.txt
 
-OUTPUT_FILE=results
-OUTPUT_EXT=.txt
 OUTPUT_DIR=Results
 FREQUENCIES=`cat /sys/devices/system/cpu/cpu0/cpufreq/scaling_available_frequencies | tr " " "\n" | sort -g | sed '1d'`
 ITER=31
@@ -35,37 +34,18 @@ else
    echo 0 > $OUTPUT_DIR/turbo
 fi
 
-for startFreq in ${FREQUENCIES}
+# The turbo frequency is neither a start nor a target frequency
+FREQUENCY_LIST=`echo "${FREQUENCIES}" | grep -v -x "$(cat $OUTPUT_DIR/turbo)" | paste -s -d ,`
+echo "Sweep over ${FREQUENCY_LIST}"
+
+# Each iteration measures every pair in one process, each frequency is calibrated once
+for i in `seq $ITER`
 do
-   # Avoid turbo as starting seq
-   if [ `cat $OUTPUT_DIR/turbo` -ne $startFreq ]
+   # Test if the iteration completed, an interrupted one is measured again
+   if ( ! (test -e "${OUTPUT_DIR}/${i}/done" ) )
    then
-      for testFreq in ${FREQUENCIES}
-      do
-         # Avoid turbo as starting seq
-         if [ $startFreq -eq $testFreq ] 
-         then
-            echo "Skip $startFreq -> $testFreq (same frequency)"
-            continue
-         fi
-
-         # Avoid turbo as starting seq
-         if [ `cat $OUTPUT_DIR/turbo` -eq $testFreq ] 
-         then
-            echo "Skip $startFreq -> $testFreq (turbo)"
-            continue
-         fi
-
-         echo "$startFreq -> $testFreq"
-         # Test if the result file already exists
-         if ( ! (test -e "${OUTPUT_DIR}/${OUTPUT_FILE}"_"${startFreq}"-"${testFreq}${OUTPUT_EXT}" ) ) 
-         then
-            for i in `seq $ITER`
-               do
-                  ./ftalat $startFreq $testFreq >> ${OUTPUT_DIR}/${OUTPUT_FILE}"_"${startFreq}"-"${testFreq}${OUTPUT_EXT}
-                 echo "############################" >> ${OUTPUT_DIR}/${OUTPUT_FILE}"_"${startFreq}"-"${testFreq}${OUTPUT_EXT}
-            done
-         fi
-      done
+      rm -rf ${OUTPUT_DIR}/${i}
+      mkdir -p ${OUTPUT_DIR}/${i}
+      ./ftalat --sweep --frequencies ${FREQUENCY_LIST} --output ${OUTPUT_DIR}/${i} && touch ${OUTPUT_DIR}/${i}/done
    fi
 done
@@ -16,18 +16,122 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "PointerChase.h"
 #include "loop.h"
 #include "rdtsc.h"
 
-unsigned long loop() {
-  unsigned long long startTime = 0;
-  unsigned long long endTime = 0;
+/*
+ * Define the variant running asmLoop() repeat times, named addl_128x<repeat>
+ */
+#define DEFINE_TIMED_LOOP(repeat)                                                                                      \
+  static unsigned long asmTimedLoop##repeat(unsigned long* pEndTime) {                                                 \
+    unsigned long long startTime = 0;                                                                                  \
+    unsigned long long endTime = 0;                                                                                    \
+                                                                                                                       \
+    sync_rdtsc1(startTime);                                                                                            \
+    for (unsigned int i = 0; i < repeat; i++) {                                                                        \
+      asmLoop();                                                                                                       \
+    }                                                                                                                  \
+    sync_rdtsc2(endTime);                                                                                              \
+                                                                                                                       \
+    *pEndTime = endTime;                                                                                               \
+    return endTime - startTime;                                                                                        \
+  }
+
+/*
+ * Define the SIMD variant running kernelLoop() 8 times. The upper halves of the vector registers are cleared at the end
+ * so that the scalar code that follows is not slowed down by SSE/AVX transitions.
+ */
+#define DEFINE_SIMD_TIMED_LOOP(name, kernelLoop)                                                                       \
+  static unsigned long name(unsigned long* pEndTime) {                                                                 \
+    unsigned long long startTime = 0;                                                                                  \
+    unsigned long long endTime = 0;                                                                                    \
+                                                                                                                       \
+    sync_rdtsc1(startTime);                                                                                            \
+    for (unsigned int i = 0; i < 8; i++) {                                                                             \
+      kernelLoop();                                                                                                    \
+    }                                                                                                                  \
+    sync_rdtsc2(endTime);                                                                                              \
+    asm volatile("vzeroupper");                                                                                        \
+                                                                                                                       \
+    *pEndTime = endTime;                                                                                               \
+    return endTime - startTime;                                                                                        \
+  }
+
+#define LOOP_KERNEL(repeat)                                                                                            \
+  {                                                                                                                    \
+      .Name = "addl_128x" #repeat,                                                                                     \
+      .pTimedLoop = asmTimedLoop##repeat,                                                                              \
+  }
 
-  sync_rdtsc1(startTime);
-  for (unsigned int i = 0; i < 8; i++) {
-    asmLoop();
+DEFINE_TIMED_LOOP(1)
+DEFINE_TIMED_LOOP(2)
+DEFINE_TIMED_LOOP(4)
+DEFINE_TIMED_LOOP(8)
+DEFINE_TIMED_LOOP(16)
+DEFINE_TIMED_LOOP(32)
+
+const struct LoopKernel loopKernels[NB_LOOP_KERNELS] = {
+    LOOP_KERNEL(1),
+    LOOP_KERNEL(2),
+    LOOP_KERNEL(4),
+    LOOP_KERNEL(8),
+    LOOP_KERNEL(16),
+    LOOP_KERNEL(32),
+};
+
+DEFINE_SIMD_TIMED_LOOP(fma256TimedLoop, asmFma256Loop)
+DEFINE_SIMD_TIMED_LOOP(fma512TimedLoop, asmFma512Loop)
+
+static bool supportsAvx2() {
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+static bool supportsAvx512() {
+  return __builtin_cpu_supports("avx512f");
+}
+
+const struct LoopKernel simdLoopKernels[NB_SIMD_LOOP_KERNELS] = {
+    {
+        .Name = "fma256_128x8",
+        .pTimedLoop = fma256TimedLoop,
+        .pSupported = supportsAvx2,
+    },
+    {
+        .Name = "fma512_128x8",
+        .pTimedLoop = fma512TimedLoop,
+        .pSupported = supportsAvx512,
+    },
+};
+
+struct LoopKernel loopKernel = LOOP_KERNEL(8);
+
+struct LoopKernel const* findLoopKernel(const char* name) {
+  for (unsigned int i = 0; i < NB_LOOP_KERNELS; i++) {
+    if (strcmp(loopKernels[i].Name, name) == 0) {
+      return &loopKernels[i];
+    }
+  }
+  for (unsigned int i = 0; i < NB_SIMD_LOOP_KERNELS; i++) {
+    if (strcmp(simdLoopKernels[i].Name, name) == 0) {
+      return &simdLoopKernels[i];
+    }
+  }
+  if (strcmp(chaseLoopKernel.Name, name) == 0) {
+    return &chaseLoopKernel;
   }
-  sync_rdtsc2(endTime);
+  return NULL;
+}
 
-  return endTime - startTime;
-}
\ No newline at end of file
+bool loopKernelSupported(struct LoopKernel const* pKernel) {
+  return pKernel->pSupported == NULL || pKernel->pSupported();
+}
+
+unsigned long loop() {
+  unsigned long endTime = 0;
+  return timedLoop(&loopKernel, &endTime);
+}
@@ -19,11 +19,75 @@
 #ifndef LOOP_H
 #define LOOP_H
 
+#include <stdbool.h>
+
+/*
+ * The assembler loop variants addl_128x1, x2, x4 ... x32 run asmLoop() 1, 2, 4 ... 32 times. A shorter loop detects the
+ * change sooner, a longer one separates closer frequencies.
+ */
+#define NB_LOOP_KERNELS 6
+
+/*
+ * The SIMD loop variants fma256_128x8 and fma512_128x8 run asmFma256Loop() and asmFma512Loop() 8 times, the CPU
+ * lowers its frequency to the AVX2 or AVX-512 license while they run
+ */
+#define NB_SIMD_LOOP_KERNELS 2
+
+/*
+ * A work loop the measurement can run
+ */
+struct LoopKernel {
+  // Used to tell apart calibrations of different loops
+  const char* Name;
+  // Returns the number of TSC counter cycles the loop took to execute and stores the TSC value at its end in pEndTime
+  unsigned long (*pTimedLoop)(unsigned long* pEndTime);
+  // Checks if the CPU can run the loop, NULL if every CPU can
+  bool (*pSupported)(void);
+  // Prepares what the loop needs before it is run and frees it, NULL if it needs nothing
+  char (*pOpen)(void);
+  void (*pClose)(void);
+};
+
+/*
+ * The assembler loop variants, from the shortest to the longest
+ */
+extern const struct LoopKernel loopKernels[NB_LOOP_KERNELS];
+
+/*
+ * The SIMD loop variants, fma256_128x8 and fma512_128x8
+ */
+extern const struct LoopKernel simdLoopKernels[NB_SIMD_LOOP_KERNELS];
+
+/*
+ * The loop run by the measurement, addl_128x8 unless an other variant is selected or the simulation replaces it
+ */
+extern struct LoopKernel loopKernel;
+
+/**
+ * Find an assembler loop variant
+ * \param name the name of the variant, e.g. addl_128x8, fma512_128x8 or chase_32
+ * \return the variant, NULL if there is none with this name
+ */
+struct LoopKernel const* findLoopKernel(const char* name);
+
+/**
+ * Check if the CPU can run a loop variant
+ */
+bool loopKernelSupported(struct LoopKernel const* pKernel);
+
 /*
- * The assembler work loop. Returns the number of TSC counter cycles this loops took to execute.
+ * The work loop. Returns the number of TSC counter cycles this loops took to execute.
  */
 unsigned long loop();
 
+/*
+ * Run a work loop. Returns the number of TSC counter cycles it took to execute and stores the TSC value at its end in
+ * pEndTime.
+ */
+static inline unsigned long timedLoop(struct LoopKernel const* pKernel, unsigned long* pEndTime) {
+  return pKernel->pTimedLoop(pEndTime);
+}
+
 #define asmLoop()                                                                                                      \
   {                                                                                                                    \
     asm volatile("addl $1,%%eax;\n\t"                                                                                  \
@@ -159,4 +223,301 @@ unsigned long loop();
                  : "%eax");                                                                                            \
   }
 
+/*
+ * 128 FMAs on 8 independent 256 bit accumulators, enough to run at the AVX2 frequency license. The registers are
+ * zeroed first so that no denormal is computed.
+ */
+#define asmFma256Loop()                                                                                                \
+  {                                                                                                                    \
+    asm volatile("vpxor %%xmm0,%%xmm0,%%xmm0;\n\t"                                                                     \
+                 "vpxor %%xmm1,%%xmm1,%%xmm1;\n\t"                                                                     \
+                 "vpxor %%xmm2,%%xmm2,%%xmm2;\n\t"                                                                     \
+                 "vpxor %%xmm3,%%xmm3,%%xmm3;\n\t"                                                                     \
+                 "vpxor %%xmm4,%%xmm4,%%xmm4;\n\t"                                                                     \
+                 "vpxor %%xmm5,%%xmm5,%%xmm5;\n\t"                                                                     \
+                 "vpxor %%xmm6,%%xmm6,%%xmm6;\n\t"                                                                     \
+                 "vpxor %%xmm7,%%xmm7,%%xmm7;\n\t"                                                                     \
+                 "vpxor %%xmm8,%%xmm8,%%xmm8;\n\t"                                                                     \
+                 "vpxor %%xmm9,%%xmm9,%%xmm9;\n\t"                                                                     \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm0;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm1;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm2;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm3;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm4;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm5;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm6;\n\t"                                                               \
+                 "vfmadd231pd %%ymm9,%%ymm8,%%ymm7;\n\t"                                                               \
+                 :                                                                                                     \
+                 :                                                                                                     \
+                 : "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm6", "%xmm7", "%xmm8", "%xmm9");          \
+  }
+
+/*
+ * Same as asmFma256Loop with 512 bit registers, runs at the AVX-512 frequency license
+ */
+#define asmFma512Loop()                                                                                                \
+  {                                                                                                                    \
+    asm volatile("vpxor %%xmm0,%%xmm0,%%xmm0;\n\t"                                                                     \
+                 "vpxor %%xmm1,%%xmm1,%%xmm1;\n\t"                                                                     \
+                 "vpxor %%xmm2,%%xmm2,%%xmm2;\n\t"                                                                     \
+                 "vpxor %%xmm3,%%xmm3,%%xmm3;\n\t"                                                                     \
+                 "vpxor %%xmm4,%%xmm4,%%xmm4;\n\t"                                                                     \
+                 "vpxor %%xmm5,%%xmm5,%%xmm5;\n\t"                                                                     \
+                 "vpxor %%xmm6,%%xmm6,%%xmm6;\n\t"                                                                     \
+                 "vpxor %%xmm7,%%xmm7,%%xmm7;\n\t"                                                                     \
+                 "vpxor %%xmm8,%%xmm8,%%xmm8;\n\t"                                                                     \
+                 "vpxor %%xmm9,%%xmm9,%%xmm9;\n\t"                                                                     \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm0;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm1;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm2;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm3;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm4;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm5;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm6;\n\t"                                                               \
+                 "vfmadd231pd %%zmm9,%%zmm8,%%zmm7;\n\t"                                                               \
+                 :                                                                                                     \
+                 :                                                                                                     \
+                 : "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm6", "%xmm7", "%xmm8", "%xmm9");          \
+  }
+
 #endif
\ No newline at end of file
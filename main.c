@@ -18,280 +18,839 @@
 
 #define _GNU_SOURCE
 
+#include <errno.h>
+#include <getopt.h>
 #include <limits.h>
 #include <pthread.h>
 #include <sched.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "FreqGetter.h"
 #include "FreqSetter.h"
 
-#include "loop.h"
-#include "rdtsc.h"
 #include "utils.h"
 
-#ifdef _DUMP
-#include "dumpResults.h"
-#endif
+#include "Arena.h"
+#include "CalibrationCache.h"
+#include "Measurement.h"
+#include "IdleState.h"
+#include "LoadStep.h"
+#include "Propagation.h"
+#include "Throughput.h"
+#include "Simulation.h"
+#include "Tracer.h"
+
+#define NB_MAX_CORES 1024
+
+// Options that only have a long name
+enum {
+  OPTION_RANDOM_WAIT = 256,
+  OPTION_FIXED_WAIT,
+  OPTION_SETTER_BACKEND,
+  OPTION_DETECTOR,
+  OPTION_SYSFS_ROOT,
+  OPTION_SIMULATE,
+  OPTION_LOOP,
+  OPTION_LICENSE,
+  OPTION_CONFIDENCE,
+  OPTION_RAMP,
+  OPTION_THROUGHPUT,
+  OPTION_LOAD_STEP,
+  OPTION_IDLE_STATE,
+};
 
-#include "ConfInterval.h"
-
-#define NB_BENCH_META_REPET 100000
-#define NB_VALIDATION_REPET 100
-#define NB_TRY_REPET_LOOP 1000000
-
-unsigned long times[NB_BENCH_META_REPET];
+/*
+ * What every measuring thread runs
+ */
+struct Job {
+  char Sweep;
+  unsigned int StartFreq;
+  unsigned int TargetFreq;
+  unsigned int* pFreqs;
+  unsigned int NbFreqs;
+  const char* OutputDir;
+  // Results of each core are written to OutputDir/core<coreID>
+  char OutputPerCore;
+  // Loop samples are traced to this file, NULL if tracing is disabled
+  const char* TraceFile;
+  // Measure the transitions into and out of the license of this SIMD loop at StartFreq, NULL to measure frequency
+  // transitions
+  struct LoopKernel const* pLicenseKernel;
+  // Issue the requests of the pair at these rates without waiting for them, NULL to measure isolated transitions
+  unsigned int* pRates;
+  unsigned int NbRates;
+  // Let the governor raise the frequency after load steps instead of requesting it
+  char LoadStep;
+  // Measure the exits from the idle state IdleState at StartFreq
+  char IdleExit;
+  unsigned int IdleState;
+};
+
+struct MeasurementThread {
+  pthread_t Thread;
+  struct MeasurementContext* pContext;
+  struct Job const* pJob;
+  int Ret;
+};
 
 void usage() {
-  fprintf(stdout, "./ftalat [-c coreID] startFreq targetFreq\n");
+  fprintf(stdout, "./ftalat [-c coreID | -C coreIDs] startFreq targetFreq\n");
+  fprintf(stdout, "./ftalat [-c coreID | -C coreIDs] --sweep [-l freq1,freq2,...] [-o outputDir]\n");
+  fprintf(stdout, "./ftalat [-c coreID | -C coreIDs] --license avx2|avx512 freq\n");
+  fprintf(stdout, "./ftalat [-c coreID | -C coreIDs] --throughput rate1,rate2,... startFreq targetFreq\n");
+  fprintf(stdout, "./ftalat [-c coreID | -C coreIDs] --load-step idleFreq targetFreq\n");
+  fprintf(stdout, "./ftalat [-c coreID | -C coreIDs] --idle-state N freq\n");
   fprintf(stdout, "\t-c coreID\t:\tto run the test on a precise core (default 0)\n");
+  fprintf(stdout, "\t-C, --cores list\t:\tcomma separated cores that are measured at the same time, one thread each\n");
+  fprintf(stdout, "\t-O, --observers list\t:\trequest the frequencies on coreID and detect the change on the comma "
+                  "separated observer cores\n");
+  fprintf(stdout, "\t-s, --sweep\t:\tmeasure every (start, target) pair of a frequency list in one run\n");
+  fprintf(stdout, "\t-l, --frequencies list\t:\tcomma separated frequencies for the sweep (default: all available)\n");
+  fprintf(stdout, "\t-o, --output dir\t:\twrite one result file per pair into dir (default: stdout)\n");
+  fprintf(stdout, "\t-n, --repetitions n\t:\tthe number of benchmark repetitions (default %u)\n", NB_REPORT_TIMES);
+  fprintf(stdout, "\t-w, --wait us\t:\tthe time to wait between frequency switches (default %u)\n", NB_WAIT_US);
+  fprintf(stdout, "\t--random-wait, --fixed-wait\t:\twait a random time between 0 and the wait time or always the "
+                  "wait time (default %s)\n", measurementConfig.WaitRandom ? "random" : "fixed");
+  fprintf(stdout, "\t-f, --setter-file file\t:\tthe cpufreq file the frequency is written to (default %s)\n",
+          FREQ_SETTER_FILE);
+  fprintf(stdout, "\t--setter-backend pwrite|stdio|uncore|epp|perf-pct|boost\t:\twrite the frequency with one pwrite "
+                  "of a preformatted string or with fprintf, set the uncore frequency of the die of the core, or write "
+                  "the values startFreq and targetFreq to energy_performance_preference, min_perf_pct and "
+                  "max_perf_pct or boost (default pwrite)\n");
+  fprintf(stdout, "\t-a, --adaptive-calibration tolerance\t:\tcalibrate until Q1, Q3 and the average change by less "
+                  "than the relative tolerance\n");
+  fprintf(stdout, "\t--confidence level\t:\tthe confidence level of the intervals and of the tests that tell close "
+                  "frequencies apart (default %g)\n",
+          CONFIDENCE_LEVEL);
+  fprintf(stdout, "\t-k, --calibration-cache file\t:\treuse the loop calibrations stored in file and store new ones\n");
+  fprintf(stdout, "\t--loop name|auto\t:\tthe loop variant, addl_128x1, x2, x4 ... x32, fma256_128x8, fma512_128x8, "
+                  "chase_32, or auto for the shortest addl one that tells the frequencies of each pair apart (default "
+                  "addl_128x8)\n");
+  fprintf(stdout, "\t--license avx2|avx512\t:\tmeasure the transitions from the loop into the fma256_128x8 or "
+                  "fma512_128x8 loop and back at freq\n");
+  fprintf(stdout, "\t--detector interval|counters|cusum\t:\tdetect the frequency change with the calibrated loop "
+                  "timings, with the cycle counters, without calibration, or with a CUSUM of the loop timings against "
+                  "both calibrations (default interval)\n");
+  fprintf(stdout, "\t-F, --format text|text-us|binary\t:\tthe format of the result files, text-us adds the durations "
+                  "in us, binary needs an output dir (default text)\n");
+  fprintf(stdout, "\t--sysfs-root dir\t:\tthe directory holding the cpu<coreID>/cpufreq directories (default %s)\n",
+          SYSFS_CPU_ROOT);
+  fprintf(stdout, "\t--simulate distribution\t:\tsimulate the frequencies, the latencies are drawn from fixed:us, "
+                  "uniform:min:max, normal:average:sd or exponential:average\n");
+  fprintf(stdout, "\t-t, --trace file\t:\trecord every loop sample into the binary file (file.core<coreID> for "
+                  "several cores)\n");
+  fprintf(stdout, "\t--throughput list\t:\tissue the requests alternating between targetFreq and startFreq at each "
+                  "comma separated rate [1/s] without waiting for them, and record which ones the core follows\n");
+  fprintf(stdout, "\t--load-step\t:\tsleep for the wait time and measure how long the governor takes to raise the "
+                  "frequency to targetFreq once the loop runs, targetFreq is written once as the limit\n");
+  fprintf(stdout, "\t--idle-state N\t:\tdisable every cpuidle state but N, sleep in it for the wait time and measure "
+                  "how long the core takes to run its first instruction and to run at freq again\n");
+  fprintf(stdout, "\t--ramp us\t:\trecord the loop samples of each frequency change from the request until us after "
+                  "the detection into outputDir/start_target-ramp.bin\n");
 }
 
-inline void wait(unsigned long time_in_us) {
-  unsigned long long before_time, after_time;
-  before_time = getusec();
-  do {
-    after_time = getusec();
-  } while (after_time - before_time < time_in_us);
+/*
+ * Parse a comma separated list of unsigned integers
+ * \return the number of values read, 0 on failure
+ */
+unsigned int parseList(const char* list, unsigned int* pValues, unsigned int maxValues) {
+  unsigned int nbValues = 0;
+  const char* pCurrent = list;
+
+  while (*pCurrent != '\0') {
+    int nbRead = 0;
+    if (nbValues >= maxValues || sscanf(pCurrent, "%u%n", &pValues[nbValues], &nbRead) != 1) {
+      return 0;
+    }
+    nbValues++;
+    pCurrent += nbRead;
+
+    if (*pCurrent == ',') {
+      pCurrent++;
+    } else if (*pCurrent != '\0') {
+      return 0;
+    }
+  }
+
+  return nbValues;
 }
 
-void measureLoop(unsigned int nbMetaRepet) {
-  for (unsigned int i = 0; i < nbMetaRepet; i++) {
-    times[i] = loop();
-#ifdef _DUMP
-    writeDump(times[i]);
-#endif
+/*
+ * Same as parseList for the frequencies of a setter backend, the knob values are checked and may be names
+ */
+unsigned int parseFreqList(enum FreqSetterBackend backend, const char* list, unsigned int* pValues,
+                           unsigned int maxValues) {
+  unsigned int nbValues = 0;
+  const char* pCurrent = list;
+
+  while (*pCurrent != '\0') {
+    char value[32] = {'\0'};
+    size_t length = strcspn(pCurrent, ",");
+
+    if (nbValues >= maxValues || length == 0 || length >= sizeof(value)) {
+      return 0;
+    }
+    memcpy(value, pCurrent, length);
+    if (parseKnobValue(backend, value, &pValues[nbValues]) != 0) {
+      return 0;
+    }
+    nbValues++;
+    pCurrent += length;
+
+    if (*pCurrent == ',') {
+      pCurrent++;
+    }
   }
+
+  return nbValues;
 }
 
-void runTest(unsigned int startFreq, unsigned int targetFreq, unsigned int coreID) {
-  struct ConfidenceInterval TargetInterval, StartInterval;
-
-  {
-    setFreq(coreID, targetFreq);
-    waitCurFreq(coreID, targetFreq);
-    // Wait 10ms for settling of the frequency
-    wait(10000);
-    measureLoop(NB_BENCH_META_REPET);
-    buildFromMeasurement(times, NB_BENCH_META_REPET, &TargetInterval);
-  }
-
-  unsigned long lastFrequencyChangeRequestCycles = 0;
-  unsigned long lastFrequencyChangeCycles = 0;
-
-  {
-    sync_rdtsc1(lastFrequencyChangeRequestCycles);
-    setFreq(coreID, startFreq);
-    waitCurFreq(coreID, startFreq);
-    sync_rdtsc2(lastFrequencyChangeCycles);
-    // Wait 10ms for settling of the frequency
-    wait(10000);
-    measureLoop(NB_BENCH_META_REPET);
-    buildFromMeasurement(times, NB_BENCH_META_REPET, &StartInterval);
-  }
-
-  dump(&StartInterval, startFreq, "Start");
-  dump(&TargetInterval, targetFreq, "Target");
-
-  // Check if the confidence intervals overlap
-  if (overlapSignificantly(&StartInterval, &TargetInterval)) {
-    fprintf(stdout, "# Warning: confidence intervals overlap considerably, "
-                    "alternatives are equal with selected confidence level\n");
-    return;
-  } else if (overlap(&StartInterval, &TargetInterval)) {
-    fprintf(stdout, "# Warning: confidence intervals overlap, we can not "
-                    "state any thing, need to do the t-test\n");
-  } else {
-    fprintf(stdout, "# Confidence intervals do not overlap, alternatives are "
-                    "statistically different with selected confidence level\n");
-  }
-
-  sync();
-  loop();
-  warmup_cpuid();
-
-  unsigned long measurements[NB_REPORT_TIMES];
-  unsigned long measurements_late[NB_REPORT_TIMES];
-  unsigned long measurements_timestamp[NB_REPORT_TIMES];
-  unsigned long measurements_waitTime[NB_REPORT_TIMES];
-  unsigned long measurements_lastFrequencyChangeRequestCycles[NB_REPORT_TIMES];
-  unsigned long measurements_lastFrequencyChangeCycles[NB_REPORT_TIMES];
-
-  for (unsigned int it = 0; it < NB_REPORT_TIMES; it++) {
-    char validated = 0;
-    unsigned long waitTimeUs = 0;
-
-#ifdef _DUMP
-    resetDump();
-#endif
-
-#ifdef NB_WAIT_RANDOM
-    waitTimeUs = xorshf96() % NB_WAIT_US;
-#else
-    waitTimeUs = NB_WAIT_US;
-#endif
-
-    // Wait some time
-    wait(waitTimeUs);
-
-    // Switch frequency to target and wait for the loop timing to be inside the interquartile band
-    {
-      unsigned long startLoopCycles = 0;
-      unsigned long lateStartLoopCycles = 0;
-      unsigned long endLoopCycles = 0;
-      unsigned int niters = 0;
-      unsigned long time = 0;
-
-      sync_rdtsc1(startLoopCycles);
-      setFreq(coreID, targetFreq);
-      sync_rdtsc1(lateStartLoopCycles);
-      do {
-        time = loop();
-#ifdef _DUMP
-        writeDump(time);
-#endif
-      } while ((time < TargetInterval.Q1 || time > TargetInterval.Q3) && ++niters < NB_TRY_REPET_LOOP);
-      sync_rdtsc2(endLoopCycles);
-
-      // Validation
-      validated = 1;
-      measurements[it] = endLoopCycles - startLoopCycles;
-      measurements_late[it] = endLoopCycles - lateStartLoopCycles;
-      measurements_timestamp[it] = endLoopCycles;
-      measurements_waitTime[it] = waitTimeUs;
-      measurements_lastFrequencyChangeRequestCycles[it] = startLoopCycles - lastFrequencyChangeRequestCycles;
-      measurements_lastFrequencyChangeCycles[it] = endLoopCycles - lastFrequencyChangeCycles;
-    }
-
-    // Validate the frequency switch
-    {
-      struct ConfidenceInterval TargetValidationInterval;
-
-      measureLoop(NB_VALIDATION_REPET);
-      buildFromMeasurement(times, NB_VALIDATION_REPET, &TargetValidationInterval);
-
-      if (!overlapSignificantlyQ1Q3(&TargetInterval, &TargetValidationInterval)) {
-        validated = 0;
+/*
+ * Warn about measured cores that share a frequency domain, they would disturb each other
+ */
+void checkFrequencyDomains(unsigned int* pCores, unsigned int nbCores) {
+  for (unsigned int i = 0; i < nbCores; i++) {
+    unsigned int affectedCore;
+    FILE* pFile = openCPUFreqFile(pCores[i], "affected_cpus", "r");
+    if (pFile == NULL) {
+      continue;
+    }
+
+    while (fscanf(pFile, "%u", &affectedCore) == 1) {
+      for (unsigned int j = i + 1; j < nbCores; j++) {
+        if (pCores[j] == affectedCore) {
+          fprintf(stderr, "Warning: cores %u and %u share a frequency domain\n", pCores[i], pCores[j]);
+        }
       }
     }
 
-    // Switch frequency to start and wait for the loop timing to be inside the interquartile band
-    {
-      unsigned long time = 0;
+    fclose(pFile);
+  }
+}
+
+void* measureCore(void* pArg) {
+  struct MeasurementThread* pThread = pArg;
+  struct MeasurementContext* ctx = pThread->pContext;
+  struct Job const* pJob = pThread->pJob;
+  const char* outputDir = pJob->OutputDir;
+  char outputDirBuffer[PATH_MAX] = {'\0'};
 
-      sync_rdtsc1(lastFrequencyChangeRequestCycles);
-      setFreq(coreID, startFreq);
-      do {
-        time = loop();
-      } while ((time < StartInterval.Q1 || time > StartInterval.Q3));
-      sync_rdtsc2(lastFrequencyChangeCycles);
+  pinCPU(ctx->CoreID);
+
+  if (pJob->OutputPerCore) {
+    snprintf(outputDirBuffer, PATH_MAX, "%s/core%u", pJob->OutputDir, ctx->CoreID);
+    if (mkdir(outputDirBuffer, 0755) != 0 && errno != EEXIST) {
+      fprintf(stderr, "Fail to create %s\n", outputDirBuffer);
     }
+    outputDir = outputDirBuffer;
+  }
+
+  if (pJob->pLicenseKernel != NULL) {
+    pThread->Ret = runLicense(ctx, pJob->StartFreq, pJob->pLicenseKernel, outputDir);
+  } else if (pJob->IdleExit) {
+    pThread->Ret = runIdleExit(ctx, pJob->IdleState, pJob->StartFreq, outputDir);
+  } else if (pJob->LoadStep) {
+    pThread->Ret = runLoadStep(ctx, pJob->StartFreq, pJob->TargetFreq, outputDir);
+  } else if (pJob->pRates != NULL) {
+    pThread->Ret = runThroughput(ctx, pJob->StartFreq, pJob->TargetFreq, pJob->pRates, pJob->NbRates, outputDir);
+  } else if (pJob->Sweep) {
+    pThread->Ret = runSweep(ctx, pJob->pFreqs, pJob->NbFreqs, outputDir);
+  } else {
+    pThread->Ret = runPair(ctx, pJob->StartFreq, pJob->TargetFreq, outputDir);
+  }
 
-    // Validate the frequency switch
-    {
-      struct ConfidenceInterval StartValidationInterval;
+  return NULL;
+}
+
+/*
+ * Measure all the cores at the same time, one pinned thread per core
+ * \return 0 if everything gone fine
+ */
+int measureCores(struct Arena* pArena, unsigned int* pCores, unsigned int nbCores, struct Job const* pJob) {
+  struct MeasurementThread* pThreads = calloc(nbCores, sizeof(struct MeasurementThread));
+  pthread_barrier_t barrier;
+  int ret = 0;
 
-      measureLoop(NB_VALIDATION_REPET);
-      buildFromMeasurement(times, NB_VALIDATION_REPET, &StartValidationInterval);
+  if (pThreads == NULL) {
+    fprintf(stderr, "Fail to allocate memory for threads\n");
+    return -1;
+  }
 
-      if (!overlapSignificantlyQ1Q3(&StartInterval, &StartValidationInterval)) {
-        validated = 0;
+  pthread_barrier_init(&barrier, NULL, nbCores);
+
+  for (unsigned int i = 0; i < nbCores; i++) {
+    pThreads[i].pJob = pJob;
+    pThreads[i].pContext = createContext(pArena, pCores[i]);
+    if (pThreads[i].pContext == NULL) {
+      ret = -1;
+      break;
+    }
+    pThreads[i].pContext->pBarrier = nbCores > 1 ? &barrier : NULL;
+
+    if (pJob->TraceFile != NULL) {
+      char traceFile[PATH_MAX];
+      if (nbCores > 1) {
+        snprintf(traceFile, PATH_MAX, "%s.core%u", pJob->TraceFile, pCores[i]);
+      } else {
+        snprintf(traceFile, PATH_MAX, "%s", pJob->TraceFile);
+      }
+
+      pThreads[i].pContext->pTracer = openTracer(traceFile, pCores[i]);
+      if (pThreads[i].pContext->pTracer == NULL) {
+        ret = -1;
+        break;
       }
     }
+  }
 
-    if (validated == 0) {
-      measurements[it] = 0;
-      measurements_late[it] = 0;
-      measurements_timestamp[it] = 0;
-      measurements_waitTime[it] = 0;
-      measurements_lastFrequencyChangeRequestCycles[it] = 0;
-      measurements_lastFrequencyChangeCycles[it] = 0;
+  if (ret != 0) {
+    // Nothing to measure
+  } else if (nbCores == 1) {
+    measureCore(&pThreads[0]);
+  } else {
+    for (unsigned int i = 0; i < nbCores; i++) {
+      pthread_create(&pThreads[i].Thread, NULL, measureCore, &pThreads[i]);
+    }
+    for (unsigned int i = 0; i < nbCores; i++) {
+      pthread_join(pThreads[i].Thread, NULL);
     }
   }
+  pthread_barrier_destroy(&barrier);
 
-  fprintf(
-      stdout,
-      "Change time (with write) [cycles]\tChange time [cycles]\tWrite cost [cycles]\tWait time [us]\tTime since last "
-      "frequency change request [cycles]\tTime since last frequency change [cycles]\tDetected frequency change "
-      "timestamp [cycles]\n");
-  for (unsigned int i = 0; i < NB_REPORT_TIMES; i++) {
-    fprintf(stdout, "%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\n", measurements[i], measurements_late[i],
-            measurements[i] - measurements_late[i], measurements_waitTime[i],
-            measurements_lastFrequencyChangeRequestCycles[i], measurements_lastFrequencyChangeCycles[i],
-            measurements_timestamp[i]);
+  for (unsigned int i = 0; i < nbCores; i++) {
+    if (pThreads[i].Ret != 0) {
+      ret = pThreads[i].Ret;
+    }
+    if (pThreads[i].pContext != NULL) {
+      closeTracer(pThreads[i].pContext->pTracer);
+    }
   }
+
+  free(pThreads);
+
+  return ret;
 }
 
 void cleanup() {
   closeFreqSetterFiles();
-
-#ifdef _DUMP
-  closeDump();
-#endif
+  closeCalibrationCache();
+  closeSimulation();
+  restoreIdleStates();
+  if (loopKernel.pClose != NULL) {
+    loopKernel.pClose();
+  }
 }
 
 int main(int argc, char** argv) {
-  if (argc != 3 && argc != 5) {
-    usage();
+  static const struct option longOptions[] = {
+      {"cores", required_argument, NULL, 'C'},
+      {"observers", required_argument, NULL, 'O'},
+      {"sweep", no_argument, NULL, 's'},
+      {"frequencies", required_argument, NULL, 'l'},
+      {"output", required_argument, NULL, 'o'},
+      {"repetitions", required_argument, NULL, 'n'},
+      {"wait", required_argument, NULL, 'w'},
+      {"random-wait", no_argument, NULL, OPTION_RANDOM_WAIT},
+      {"fixed-wait", no_argument, NULL, OPTION_FIXED_WAIT},
+      {"setter-file", required_argument, NULL, 'f'},
+      {"setter-backend", required_argument, NULL, OPTION_SETTER_BACKEND},
+      {"adaptive-calibration", required_argument, NULL, 'a'},
+      {"calibration-cache", required_argument, NULL, 'k'},
+      {"confidence", required_argument, NULL, OPTION_CONFIDENCE},
+      {"loop", required_argument, NULL, OPTION_LOOP},
+      {"license", required_argument, NULL, OPTION_LICENSE},
+      {"detector", required_argument, NULL, OPTION_DETECTOR},
+      {"format", required_argument, NULL, 'F'},
+      {"trace", required_argument, NULL, 't'},
+      {"ramp", required_argument, NULL, OPTION_RAMP},
+      {"throughput", required_argument, NULL, OPTION_THROUGHPUT},
+      {"load-step", no_argument, NULL, OPTION_LOAD_STEP},
+      {"idle-state", required_argument, NULL, OPTION_IDLE_STATE},
+      {"sysfs-root", required_argument, NULL, OPTION_SYSFS_ROOT},
+      {"simulate", required_argument, NULL, OPTION_SIMULATE},
+      {NULL, 0, NULL, 0},
+  };
+
+  unsigned int cores[NB_MAX_CORES] = {0};
+  unsigned int nbCores = 1;
+  unsigned int observers[NB_MAX_CORES];
+  unsigned int nbObservers = 0;
+
+  struct Job job = {0};
+  const char* frequencyList = NULL;
+  const char* calibrationCacheFile = NULL;
+  const char* setterFile = FREQ_SETTER_FILE;
+  enum FreqSetterBackend setterBackend = FREQ_SETTER_PWRITE;
+  struct LatencyDistribution simulatedLatency;
+  bool simulate = false;
+  bool loopSelected = false;
+  struct Arena arena = {0};
+  unsigned int freqs[NB_MAX_FREQS];
+  unsigned int rates[NB_MAX_RATES];
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "c:C:O:sl:o:n:w:f:a:k:F:t:", longOptions, NULL)) != -1) {
+    switch (opt) {
+    // Option for core specification
+    case 'c':
+      if (sscanf(optarg, "%u", &cores[0]) != 1) {
+        fprintf(stderr, "Fail to get the core ID argument\n");
+        return -2;
+      }
+      nbCores = 1;
+      break;
+    case 'C':
+      nbCores = parseList(optarg, cores, NB_MAX_CORES);
+      if (nbCores == 0) {
+        fprintf(stderr, "Fail to get the core IDs argument\n");
+        return -2;
+      }
+      break;
+    case 'O':
+      nbObservers = parseList(optarg, observers, NB_MAX_CORES);
+      if (nbObservers == 0) {
+        fprintf(stderr, "Fail to get the observer core IDs argument\n");
+        return -2;
+      }
+      break;
+    case 's':
+      job.Sweep = 1;
+      break;
+    case 'l':
+      frequencyList = optarg;
+      break;
+    case 'o':
+      job.OutputDir = optarg;
+      break;
+    case 'n':
+      if (sscanf(optarg, "%u", &measurementConfig.NbReportTimes) != 1 || measurementConfig.NbReportTimes == 0) {
+        fprintf(stderr, "Fail to get the repetitions argument\n");
+        return -2;
+      }
+      break;
+    case 'w':
+      if (sscanf(optarg, "%lu", &measurementConfig.WaitUs) != 1) {
+        fprintf(stderr, "Fail to get the wait time argument\n");
+        return -2;
+      }
+      break;
+    case OPTION_RANDOM_WAIT:
+      measurementConfig.WaitRandom = true;
+      break;
+    case OPTION_FIXED_WAIT:
+      measurementConfig.WaitRandom = false;
+      break;
+    case 'f':
+      setterFile = optarg;
+      break;
+    case OPTION_SETTER_BACKEND:
+      if (strcmp(optarg, "pwrite") == 0) {
+        setterBackend = FREQ_SETTER_PWRITE;
+      } else if (strcmp(optarg, "stdio") == 0) {
+        setterBackend = FREQ_SETTER_STDIO;
+      } else if (strcmp(optarg, "uncore") == 0) {
+        setterBackend = FREQ_SETTER_UNCORE;
+      } else if (strcmp(optarg, "epp") == 0) {
+        setterBackend = FREQ_SETTER_EPP;
+      } else if (strcmp(optarg, "perf-pct") == 0) {
+        setterBackend = FREQ_SETTER_PERF_PCT;
+      } else if (strcmp(optarg, "boost") == 0) {
+        setterBackend = FREQ_SETTER_BOOST;
+      } else {
+        fprintf(stderr, "Unknown setter backend %s\n", optarg);
+        return -2;
+      }
+      break;
+    case 'a':
+      if (sscanf(optarg, "%lf", &measurementConfig.CalibrationTolerance) != 1 ||
+          measurementConfig.CalibrationTolerance <= 0) {
+        fprintf(stderr, "Fail to get the calibration tolerance argument\n");
+        return -2;
+      }
+      break;
+    case 'k':
+      calibrationCacheFile = optarg;
+      break;
+    case OPTION_THROUGHPUT:
+      job.NbRates = parseList(optarg, rates, NB_MAX_RATES);
+      if (job.NbRates == 0) {
+        fprintf(stderr, "Fail to get the request rates argument\n");
+        return -2;
+      }
+      for (unsigned int i = 0; i < job.NbRates; i++) {
+        if (rates[i] == 0) {
+          fprintf(stderr, "The request rates must not be 0\n");
+          return -2;
+        }
+      }
+      job.pRates = rates;
+      break;
+    case OPTION_LOAD_STEP:
+      job.LoadStep = 1;
+      break;
+    case OPTION_IDLE_STATE:
+      if (sscanf(optarg, "%u", &job.IdleState) != 1 || job.IdleState >= NB_MAX_IDLE_STATES) {
+        fprintf(stderr, "Fail to get the idle state argument\n");
+        return -2;
+      }
+      job.IdleExit = 1;
+      break;
+    case OPTION_RAMP:
+      if (sscanf(optarg, "%lu", &measurementConfig.RampAfterUs) != 1) {
+        fprintf(stderr, "Fail to get the ramp time argument\n");
+        return -2;
+      }
+      measurementConfig.RecordRamp = true;
+      break;
+    case OPTION_CONFIDENCE: {
+      double level = 0;
+      if (sscanf(optarg, "%lf", &level) != 1 || level <= 0 || level >= 1) {
+        fprintf(stderr, "Fail to get the confidence level argument, it must be between 0 and 1\n");
+        return -2;
+      }
+      setConfidenceLevel(level);
+      break;
+    }
+    case OPTION_LOOP:
+      if (strcmp(optarg, "auto") == 0) {
+        measurementConfig.AutoLoopKernel = true;
+      } else if (findLoopKernel(optarg) != NULL) {
+        loopKernel = *findLoopKernel(optarg);
+        if (!loopKernelSupported(&loopKernel)) {
+          fprintf(stderr, "The CPU can not run the loop %s\n", optarg);
+          return -2;
+        }
+      } else {
+        fprintf(stderr, "Unknown loop %s\n", optarg);
+        return -2;
+      }
+      loopSelected = true;
+      break;
+    case OPTION_LICENSE:
+      if (strcmp(optarg, "avx2") == 0) {
+        job.pLicenseKernel = findLoopKernel("fma256_128x8");
+      } else if (strcmp(optarg, "avx512") == 0) {
+        job.pLicenseKernel = findLoopKernel("fma512_128x8");
+      } else {
+        fprintf(stderr, "Unknown license %s\n", optarg);
+        return -2;
+      }
+      break;
+    case OPTION_DETECTOR:
+      if (strcmp(optarg, "interval") == 0) {
+        measurementConfig.Detector = DETECTOR_INTERVAL;
+      } else if (strcmp(optarg, "counters") == 0) {
+        measurementConfig.Detector = DETECTOR_COUNTERS;
+      } else if (strcmp(optarg, "cusum") == 0) {
+        measurementConfig.Detector = DETECTOR_CUSUM;
+      } else {
+        fprintf(stderr, "Unknown detector %s\n", optarg);
+        return -2;
+      }
+      break;
+    case 'F':
+      if (strcmp(optarg, "text") == 0) {
+        measurementConfig.Format = RESULT_FORMAT_TEXT;
+      } else if (strcmp(optarg, "text-us") == 0) {
+        measurementConfig.Format = RESULT_FORMAT_TEXT_US;
+      } else if (strcmp(optarg, "binary") == 0) {
+        measurementConfig.Format = RESULT_FORMAT_BINARY;
+      } else {
+        fprintf(stderr, "Unknown result format %s\n", optarg);
+        return -2;
+      }
+      break;
+    case 't':
+      job.TraceFile = optarg;
+      break;
+    case OPTION_SYSFS_ROOT:
+      sysfsCpuRoot = optarg;
+      break;
+    case OPTION_SIMULATE:
+      if (parseLatencyDistribution(optarg, &simulatedLatency) != 0) {
+        fprintf(stderr, "Fail to get the simulated latency distribution argument\n");
+        return -2;
+      }
+      simulate = true;
+      break;
+    default:
+      usage();
+      return -1;
+    }
+  }
+
+  if (job.Sweep) {
+    if (optind != argc) {
+      usage();
+      return -1;
+    }
+  } else if (job.pLicenseKernel != NULL || job.IdleExit) {
+    if (argc - optind != 1) {
+      fprintf(stderr, "Missing frequency argument\n");
+      usage();
+      return -1;
+    }
+
+    if (parseKnobValue(setterBackend, argv[optind], &job.StartFreq) != 0) {
+      fprintf(stderr, "Fail to get the frequency argument\n");
+      return -3;
+    }
+    job.TargetFreq = job.StartFreq;
+  } else {
+    if (argc - optind != 2) {
+      fprintf(stderr, "Missing frequencies arguments\n");
+      usage();
+      return -1;
+    }
+
+    if (parseKnobValue(setterBackend, argv[optind], &job.StartFreq) != 0) {
+      fprintf(stderr, "Fail to get the start frequency argument\n");
+      return -3;
+    }
+
+    if (parseKnobValue(setterBackend, argv[optind + 1], &job.TargetFreq) != 0) {
+      fprintf(stderr, "Fail to get the target freq argument\n");
+      return -4;
+    }
+  }
+
+  // Additional checks
+  for (unsigned int i = 0; i < nbCores; i++) {
+    if (cores[i] >= getCoreNumber()) {
+      fprintf(stdout, "The core ID that user gave is invalid\n");
+      if (nbCores > 1) {
+        return -2;
+      }
+      fprintf(stdout, "Core ID is set to 0\n");
+      cores[i] = 0;
+    }
+  }
+
+  for (unsigned int i = 0; i < nbObservers; i++) {
+    if (observers[i] >= getCoreNumber() || observers[i] == cores[0]) {
+      fprintf(stdout, "The observer core ID that user gave is invalid\n");
+      return -2;
+    }
+  }
+
+  if (nbObservers > 0 && (job.Sweep || nbCores > 1 || measurementConfig.Detector != DETECTOR_INTERVAL ||
+                          measurementConfig.AutoLoopKernel)) {
+    fprintf(stderr, "Observers can only be used with a single core and frequency pair, the interval detector and a "
+                    "fixed loop\n");
+    return -1;
+  }
+
+  // The propagation writes its own text report to stdout
+  if (nbObservers > 0 && (job.OutputDir != NULL || job.TraceFile != NULL ||
+                          measurementConfig.Format != RESULT_FORMAT_TEXT)) {
+    fprintf(stderr, "Observers write their results to stdout as text in cycles, without output directory, trace or "
+                    "other format\n");
+    return -1;
+  }
+
+  if (job.pLicenseKernel != NULL) {
+    if (!loopKernelSupported(job.pLicenseKernel)) {
+      fprintf(stderr, "The CPU can not run the loop %s\n", job.pLicenseKernel->Name);
+      return -2;
+    }
+    if (job.Sweep || nbObservers > 0 || simulate || measurementConfig.Detector != DETECTOR_INTERVAL ||
+        measurementConfig.AutoLoopKernel) {
+      fprintf(stderr, "The license transitions are measured on a fixed frequency with the interval detector, without "
+                      "observers, simulation or automatic loop\n");
+      return -1;
+    }
+  }
+
+  if (nbCores > 1) {
+    if (job.OutputDir == NULL) {
+      fprintf(stderr, "Measuring several cores needs an output directory\n");
+      return -1;
+    }
+    job.OutputPerCore = 1;
+    checkFrequencyDomains(cores, nbCores);
+  }
+
+  if (job.Sweep && frequencyList == NULL && isKnobBackend(setterBackend)) {
+    fprintf(stderr, "The sweep of a knob needs the list of its values\n");
+    return -5;
+  }
+
+  if (job.Sweep) {
+    if (frequencyList != NULL) {
+      job.NbFreqs = parseFreqList(setterBackend, frequencyList, freqs, NB_MAX_FREQS);
+    } else if (setterBackend == FREQ_SETTER_UNCORE) {
+      job.NbFreqs = getAvailableUncoreFrequencies(cores[0], freqs, NB_MAX_FREQS);
+    } else {
+      job.NbFreqs = getAvailableFrequencies(cores[0], freqs, NB_MAX_FREQS);
+    }
+    job.pFreqs = freqs;
+
+    if (job.NbFreqs < 2) {
+      fprintf(stderr, "Fail to get at least two frequencies for the sweep\n");
+      return -5;
+    }
+  }
+
+  if (measurementConfig.Format == RESULT_FORMAT_BINARY && (job.OutputDir == NULL || nbObservers > 0)) {
+    fprintf(stderr, "The binary format needs an output directory and can not be used with observers\n");
     return -1;
   }
 
-  unsigned int coreID = 0;
-  unsigned int startFreq = 0;
-  unsigned int targetFreq = 0;
+  if (job.pRates != NULL &&
+      (job.Sweep || nbObservers > 0 || job.pLicenseKernel != NULL || measurementConfig.RecordRamp ||
+       measurementConfig.Detector != DETECTOR_INTERVAL || measurementConfig.AutoLoopKernel)) {
+    fprintf(stderr, "The request throughput is measured on one frequency pair with the interval detector and a fixed "
+                    "loop, without observers, license transitions or ramps\n");
+    return -1;
+  }
 
-  unsigned int argcCounter = 1;
+  if (job.pRates != NULL && measurementConfig.Format != RESULT_FORMAT_TEXT) {
+    fprintf(stderr, "The request throughput is written as text in cycles, the other formats can not be used\n");
+    return -1;
+  }
 
-  // Option for core specification
-  if (strcmp(argv[1], "-c") == 0) {
-    if (sscanf(argv[2], "%u", &coreID) != 1) {
-      fprintf(stderr, "Fail to get the core ID argument\n");
+  if (job.LoadStep) {
+    if (job.Sweep || nbObservers > 0 || job.pLicenseKernel != NULL || job.pRates != NULL ||
+        measurementConfig.RecordRamp || measurementConfig.Detector != DETECTOR_INTERVAL ||
+        measurementConfig.AutoLoopKernel || simulate || setterBackend == FREQ_SETTER_UNCORE ||
+        isKnobBackend(setterBackend)) {
+      fprintf(stderr, "The load steps are measured on one frequency pair of the core with the interval detector and a "
+                      "fixed loop, without observers, license transitions, request rates, ramps or simulation\n");
+      return -1;
+    }
+    if (job.TargetFreq <= job.StartFreq) {
+      fprintf(stderr, "The governor raises the frequency after a load step, targetFreq must be higher than idleFreq\n");
       return -2;
     }
-    argcCounter += 2;
+  }
 
-    if (argc != 5) {
-      fprintf(stderr, "Missing frequencies arguments\n");
-      usage();
+  if (job.IdleExit) {
+    if (job.Sweep || nbObservers > 0 || job.pLicenseKernel != NULL || job.pRates != NULL || job.LoadStep ||
+        measurementConfig.RecordRamp || measurementConfig.Detector != DETECTOR_INTERVAL ||
+        measurementConfig.AutoLoopKernel || simulate || setterBackend == FREQ_SETTER_UNCORE ||
+        isKnobBackend(setterBackend)) {
+      fprintf(stderr, "The idle state exits are measured on one frequency of the core with the interval detector and "
+                      "a fixed loop, without observers, license transitions, request rates, load steps, ramps or "
+                      "simulation\n");
       return -1;
     }
+    if (measurementConfig.WaitUs == 0) {
+      fprintf(stderr, "The core only enters the idle state while sleeping, the idle state exits need a wait time\n");
+      return -2;
+    }
   }
 
-  if (sscanf(argv[argcCounter], "%u", &startFreq) != 1) {
-    fprintf(stderr, "Fail to get the start frequency argument\n");
-    return -3;
+  if (measurementConfig.RecordRamp && (job.OutputDir == NULL || nbObservers > 0 || job.pLicenseKernel != NULL)) {
+    fprintf(stderr, "The ramps need an output directory and can not be recorded with observers or license "
+                    "transitions\n");
+    return -1;
   }
 
-  if (sscanf(argv[argcCounter + 1], "%u", &targetFreq) != 1) {
-    fprintf(stderr, "Fail to get the target freq argument\n");
-    return -4;
+  if (measurementConfig.WaitRandom && measurementConfig.WaitUs == 0) {
+    fprintf(stderr, "A random wait needs a wait time\n");
+    return -2;
   }
 
-  // Additional checks
-  if (coreID >= getCoreNumber()) {
-    fprintf(stdout, "The core ID that user gave is invalid\n");
-    fprintf(stdout, "Core ID is set to 0\n");
-    coreID = 0;
+  if (setterBackend == FREQ_SETTER_UNCORE && (simulate || measurementConfig.Detector == DETECTOR_COUNTERS)) {
+    fprintf(stderr, "The uncore frequency can not be simulated or detected with the core cycle counters\n");
+    return -1;
   }
 
-#ifdef _DUMP
-  openDump("./results.dump", NB_TRY_REPET_LOOP * NB_VALIDATION_REPET);
-#endif
+  if (isKnobBackend(setterBackend) && (simulate || measurementConfig.Detector == DETECTOR_COUNTERS)) {
+    fprintf(stderr, "A knob can not be simulated or detected with the cycle counters, the frequency it leads to is not "
+                    "known\n");
+    return -1;
+  }
 
-  pinCPU(coreID);
+  if (isGlobalKnobBackend(setterBackend) && nbCores > 1) {
+    fprintf(stderr, "The knob is shared by all the cores, it can only be measured on one core\n");
+    return -1;
+  }
+
+  if (simulate) {
+    if (measurementConfig.Detector == DETECTOR_COUNTERS) {
+      fprintf(stderr, "The counter detector can not measure simulated frequencies\n");
+      return -1;
+    }
+    if (loopSelected) {
+      fprintf(stderr, "The simulation runs its own loop, --loop can not be used\n");
+      return -1;
+    }
+    if (nbObservers > 0) {
+      fprintf(stderr, "The simulated frequencies belong to each core, the observers would never see the change\n");
+      return -1;
+    }
+    bool zeroFreq = !job.Sweep && (job.StartFreq == 0 || job.TargetFreq == 0);
+    for (unsigned int i = 0; job.Sweep && i < job.NbFreqs; i++) {
+      zeroFreq = zeroFreq || job.pFreqs[i] == 0;
+    }
+    if (zeroFreq) {
+      fprintf(stderr, "A simulated core can not run at 0 kHz\n");
+      return -1;
+    }
+    if (openSimulation(&simulatedLatency) != 0) {
+      return -7;
+    }
+    setterBackend = FREQ_SETTER_SIMULATED;
+  }
+
+  if (loopKernel.pOpen != NULL && loopKernel.pOpen() != 0) {
+    cleanup();
+    return -7;
+  }
+
+  // All the buffers written during the measurement are allocated up front, including one histogram per calibration
+  measurementConfig.NbCalibrationHistograms =
+      (job.Sweep ? job.NbFreqs : 2) * (measurementConfig.AutoLoopKernel ? NB_LOOP_KERNELS : 1);
+  size_t arenaBytes = nbObservers > 0 ? propagationArenaSize(nbObservers) : nbCores * contextArenaSize();
+  if (createArena(&arena, arenaBytes) != 0) {
+    cleanup();
+    return -7;
+  }
+
+  if (calibrationCacheFile != NULL && openCalibrationCache(calibrationCacheFile) != 0) {
+    destroyArena(&arena);
+    cleanup();
+    return -6;
+  }
 
   // Set the minimal frequency
-  if (openFreqSetterFiles() != 0) {
+  unsigned int pairFreqs[2] = {job.StartFreq, job.TargetFreq};
+  if (openFreqSetterFiles(setterFile, setterBackend, job.Sweep ? job.pFreqs : pairFreqs,
+                          job.Sweep ? job.NbFreqs : 2) != 0) {
+    destroyArena(&arena);
     cleanup();
     return -3;
   }
 
-  runTest(startFreq, targetFreq, coreID);
+  for (unsigned int i = 0; job.IdleExit && i < nbCores; i++) {
+    if (selectIdleState(cores[i], job.IdleState) != 0) {
+      destroyArena(&arena);
+      cleanup();
+      return -3;
+    }
+  }
+
+  // The TSC frequency written to the result files is detected before any thread starts measuring
+  fprintf(stderr, "TSC frequency %lu Hz (%s)\n", getTscFrequency(), getTscFrequencySource());
+  if (!isTscInvariant()) {
+    fprintf(stderr, "Warning: the TSC is not invariant, its cycles may not be time across frequencies and C-states\n");
+  }
 
+  int ret = 0;
+  if (nbObservers > 0) {
+    ret = runPropagation(&arena, stdout, cores[0], observers, nbObservers, job.StartFreq, job.TargetFreq);
+  } else {
+    ret = measureCores(&arena, cores, nbCores, &job);
+  }
+
+  destroyArena(&arena);
   cleanup();
 
-  return 0;
-}
\ No newline at end of file
+  return ret;
+}
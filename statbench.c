@@ -0,0 +1,123 @@
+/*
+ * ftalat - Frequency Transition Latency Estimator
+ * Copyright (C) 2013 Universite de Versailles
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ConfInterval.h"
+
+// Sizes of the measurements: NB_VALIDATION_REPET and the order of a long calibration
+static const unsigned int benchSizes[] = {
+    100,
+    100000,
+};
+
+// Each size is timed on about this many samples in total, so both sizes run for a similar time
+#define BENCH_TOTAL_SAMPLES 100000000UL
+
+/* Fill the samples with timings of a loop around 1000 cycles with a few slow outliers, like a validation */
+static void fillSamples(unsigned long* samples, unsigned int n) {
+  for (unsigned int i = 0; i < n; i++) {
+    samples[i] = 1000 + rand() % 64;
+    if (rand() % 100 == 0) {
+      samples[i] += 20000;
+    }
+  }
+}
+
+/* The three passes and the sort buildFromMeasurement used to do */
+static void buildReference(unsigned long* Times, unsigned int NbTimes, struct ConfidenceInterval* Interval) {
+  Interval->NbSamples = NbTimes;
+  Interval->Average = average(NbTimes, Times);
+  Interval->StandardDeviation = sd(NbTimes, Interval->Average, Times);
+  confidenceInterval(NbTimes, Interval->Average, Interval->StandardDeviation, &Interval->LowerBound,
+                     &Interval->UpperBound);
+  interQuartileRange(NbTimes, Times, &Interval->Q1, &Interval->Q3);
+  Interval->pHistogram = NULL;
+}
+
+static double nowNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Time one build function, the samples are copied back before each call since the builds reorder them */
+static double timeBuild(void (*pBuild)(unsigned long*, unsigned int, struct ConfidenceInterval*),
+                        unsigned long const* samples, unsigned long* work, unsigned int n, unsigned long nbCalls,
+                        struct ConfidenceInterval* Interval) {
+  double copyTime, start;
+
+  start = nowNs();
+  for (unsigned long call = 0; call < nbCalls; call++) {
+    memcpy(work, samples, n * sizeof(unsigned long));
+    __asm__ __volatile__("" : : "r"(work) : "memory");
+  }
+  copyTime = nowNs() - start;
+
+  start = nowNs();
+  for (unsigned long call = 0; call < nbCalls; call++) {
+    memcpy(work, samples, n * sizeof(unsigned long));
+    pBuild(work, n, Interval);
+  }
+
+  return (nowNs() - start - copyTime) / nbCalls;
+}
+
+/*
+ * Compare the time of buildFromMeasurement with the former average, sd and qsort implementation
+ */
+int main(void) {
+  srand(42);
+
+  for (unsigned int s = 0; s < sizeof(benchSizes) / sizeof(benchSizes[0]); s++) {
+    unsigned int n = benchSizes[s];
+    unsigned long nbCalls = BENCH_TOTAL_SAMPLES / n;
+    unsigned long* samples = malloc(n * sizeof(unsigned long));
+    unsigned long* work = malloc(n * sizeof(unsigned long));
+    struct ConfidenceInterval reference, single;
+    double referenceNs, singleNs;
+
+    if (samples == NULL || work == NULL) {
+      fprintf(stderr, "Fail to allocate %u samples\n", n);
+      return -1;
+    }
+    fillSamples(samples, n);
+
+    referenceNs = timeBuild(buildReference, samples, work, n, nbCalls, &reference);
+    singleNs = timeBuild(buildFromMeasurement, samples, work, n, nbCalls, &single);
+
+    if (reference.Q1 != single.Q1 || reference.Q3 != single.Q3 || reference.LowerBound != single.LowerBound ||
+        reference.UpperBound != single.UpperBound) {
+      fprintf(stderr, "Results differ for n = %u: Q1 %lu / %lu, Q3 %lu / %lu, interval [%lu ; %lu] / [%lu ; %lu]\n", n,
+              reference.Q1, single.Q1, reference.Q3, single.Q3, reference.LowerBound, reference.UpperBound,
+              single.LowerBound, single.UpperBound);
+      return -2;
+    }
+
+    fprintf(stdout, "n = %u: reference %.0f ns, single pass %.0f ns, speedup %.2f\n", n, referenceNs, singleNs,
+            referenceNs / singleNs);
+
+    free(samples);
+    free(work);
+  }
+
+  return 0;
+}
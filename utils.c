@@ -23,13 +23,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <fcntl.h>
 #include <sched.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+const char* sysfsCpuRoot = SYSFS_CPU_ROOT;
+
+void cpuFreqFilePath(char* pBuffer, unsigned int coreID, const char* fileName) {
+  snprintf(pBuffer, BUFFER_PATH_SIZE, CPU_PATH_FORMAT, sysfsCpuRoot, coreID, fileName);
+}
+
 FILE* openCPUFreqFile(unsigned int coreID, const char* fileName, const char* mode) {
   char filePathBuffer[BUFFER_PATH_SIZE] = {'\0'};
-  snprintf(filePathBuffer, BUFFER_PATH_SIZE, CPU_PATH_FORMAT, coreID, fileName);
+  cpuFreqFilePath(filePathBuffer, coreID, fileName);
 
   FILE* pFile = fopen(filePathBuffer, mode);
   if (pFile == NULL) {
@@ -39,14 +46,95 @@ FILE* openCPUFreqFile(unsigned int coreID, const char* fileName, const char* mod
   return pFile;
 }
 
+int openCPUFreqFd(unsigned int coreID, const char* fileName, int flags) {
+  char filePathBuffer[BUFFER_PATH_SIZE] = {'\0'};
+  cpuFreqFilePath(filePathBuffer, coreID, fileName);
+
+  int fd = open(filePathBuffer, flags);
+  if (fd < 0) {
+    fprintf(stderr, "Fail to open %s\n", filePathBuffer);
+  }
+
+  return fd;
+}
+
+void cpuRootFilePath(char* pBuffer, const char* fileName) {
+  snprintf(pBuffer, BUFFER_PATH_SIZE, "%s/%s", sysfsCpuRoot, fileName);
+}
+
+int openCpuRootFd(const char* fileName, int flags) {
+  char filePathBuffer[BUFFER_PATH_SIZE] = {'\0'};
+  cpuRootFilePath(filePathBuffer, fileName);
+
+  int fd = open(filePathBuffer, flags);
+  if (fd < 0) {
+    fprintf(stderr, "Fail to open %s\n", filePathBuffer);
+  }
+
+  return fd;
+}
+
+/*
+ * Read a number from the topology directory of a core
+ * \return the number, 0 if the file does not exist (e.g. die_id on older kernels)
+ */
+static unsigned int readTopology(unsigned int coreID, const char* fileName) {
+  char filePathBuffer[BUFFER_PATH_SIZE] = {'\0'};
+  unsigned int value = 0;
+
+  snprintf(filePathBuffer, BUFFER_PATH_SIZE, "%s/cpu%u/topology/%s", sysfsCpuRoot, coreID, fileName);
+  FILE* pFile = fopen(filePathBuffer, "r");
+  if (pFile != NULL) {
+    if (fscanf(pFile, "%u", &value) != 1) {
+      value = 0;
+    }
+    fclose(pFile);
+  }
+
+  return value;
+}
+
+void uncoreFilePath(char* pBuffer, unsigned int coreID, const char* fileName) {
+  snprintf(pBuffer, BUFFER_PATH_SIZE, UNCORE_PATH_FORMAT, sysfsCpuRoot, readTopology(coreID, "physical_package_id"),
+           readTopology(coreID, "die_id"), fileName);
+}
+
+int openUncoreFd(unsigned int coreID, const char* fileName, int flags) {
+  char filePathBuffer[BUFFER_PATH_SIZE] = {'\0'};
+  uncoreFilePath(filePathBuffer, coreID, fileName);
+
+  int fd = open(filePathBuffer, flags);
+  if (fd < 0) {
+    fprintf(stderr, "Fail to open %s\n", filePathBuffer);
+  }
+
+  return fd;
+}
+
+int writeAll(int fd, const void* pData, size_t size) {
+  const char* pCurrent = pData;
+
+  while (size > 0) {
+    ssize_t written = write(fd, pCurrent, size);
+    if (written <= 0) {
+      perror("write");
+      return -1;
+    }
+    pCurrent += written;
+    size -= written;
+  }
+
+  return 0;
+}
+
 void pinCPU(int cpu) {
   cpu_set_t cpuset;
-  pid_t myself = getpid();
 
   CPU_ZERO(&cpuset);
   CPU_SET(cpu, &cpuset);
 
-  int ret = sched_setaffinity(myself, sizeof(cpu_set_t), &cpuset);
+  // 0 is the calling thread, every measuring thread pins itself
+  int ret = sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
   if (ret != 0) {
     perror("sched_setaffinity");
     exit(0);
@@ -55,7 +143,8 @@ void pinCPU(int cpu) {
 
 // from
 // http://stackoverflow.com/questions/1640258/need-a-fast-random-generator-for-c
-static unsigned long x = 123456789, y = 362436069, z = 521288629;
+// Each measuring thread has its own generator state
+static __thread unsigned long x = 123456789, y = 362436069, z = 521288629;
 
 unsigned long xorshf96() { // period 2^96-1
   unsigned long t;
@@ -19,15 +19,34 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <limits.h>
 #include <stdio.h>
 
-#define BUFFER_PATH_SIZE 100
+#define BUFFER_PATH_SIZE PATH_MAX
 
-#define CPU_PATH_FORMAT "/sys/devices/system/cpu/cpu%d/cpufreq/%s"
+#ifndef SYSFS_CPU_ROOT
+#define SYSFS_CPU_ROOT "/sys/devices/system/cpu"
+#endif
+
+#define CPU_PATH_FORMAT "%s/cpu%d/cpufreq/%s"
+#define UNCORE_PATH_FORMAT "%s/intel_uncore_frequency/package_%02u_die_%02u/%s"
+
+/*
+ * The directory holding the cpu<coreID> directories, SYSFS_CPU_ROOT unless overridden with --sysfs-root
+ */
+extern const char* sysfsCpuRoot;
+
+/**
+ * Build the path of a file related to a CPU core
+ * \param pBuffer the buffer of BUFFER_PATH_SIZE bytes the path is written to
+ * \param coreID the id of the core to look at
+ * \param fileName the name of the file
+ */
+void cpuFreqFilePath(char* pBuffer, unsigned int coreID, const char* fileName);
 
 /**
  * Easy to use function to open any file related to a CPU core
- * (files are located in /sys/devices/system/cpu/cpu[coreID]/cpufreq/)
+ * (files are located in sysfsCpuRoot/cpu[coreID]/cpufreq/)
  * \param coreID the id of the core to look at
  * \param fileName the name of the file to open
  * \param mode the opening mode
@@ -37,7 +56,58 @@
 FILE* openCPUFreqFile(unsigned int coreID, const char* fileName, const char* mode);
 
 /**
- * Pin the current program to a specific core using CPU_SET and
+ * Same as openCPUFreqFile, but returns a file descriptor opened with open(2)
+ * \param coreID the id of the core to look at
+ * \param fileName the name of the file to open
+ * \param flags the flags given to open
+ * \return the file descriptor, -1 on failure
+ */
+int openCPUFreqFd(unsigned int coreID, const char* fileName, int flags);
+
+/**
+ * Build the path of a file under sysfsCpuRoot that is not specific to a core, e.g. intel_pstate/max_perf_pct
+ * \param pBuffer the buffer of BUFFER_PATH_SIZE bytes the path is written to
+ * \param fileName the path of the file relative to sysfsCpuRoot
+ */
+void cpuRootFilePath(char* pBuffer, const char* fileName);
+
+/**
+ * Same as openCPUFreqFd for a file under sysfsCpuRoot that is not specific to a core
+ * \param fileName the path of the file relative to sysfsCpuRoot
+ * \param flags the flags given to open
+ * \return the file descriptor, -1 on failure
+ */
+int openCpuRootFd(const char* fileName, int flags);
+
+/**
+ * Build the path of a file of the intel_uncore_frequency directory of the die a CPU core belongs to
+ * (sysfsCpuRoot/intel_uncore_frequency/package_[package]_die_[die]/)
+ * \param pBuffer the buffer of BUFFER_PATH_SIZE bytes the path is written to
+ * \param coreID the id of the core whose die is looked at
+ * \param fileName the name of the file
+ */
+void uncoreFilePath(char* pBuffer, unsigned int coreID, const char* fileName);
+
+/**
+ * Same as openCPUFreqFd for a file of the uncore frequency directory of a core
+ * \param coreID the id of the core whose die is looked at
+ * \param fileName the name of the file to open
+ * \param flags the flags given to open
+ * \return the file descriptor, -1 on failure
+ */
+int openUncoreFd(unsigned int coreID, const char* fileName, int flags);
+
+/**
+ * Write a whole buffer to a file descriptor, retrying the partial writes
+ * \param fd the file descriptor
+ * \param pData the buffer
+ * \param size the number of bytes to write
+ * \return 0 if everything gone fine
+ */
+int writeAll(int fd, const void* pData, size_t size);
+
+/**
+ * Pin the calling thread to a specific core using CPU_SET and
  * sched_setaffinity
  * \param cpu the core id to which one the function pin the program
  */